@@ -0,0 +1,142 @@
+//
+//  SolverAllocations.cpp
+//
+//  Counts the heap allocations of the scene update once the solver has warmed up, and fails if there is any.
+//  Built on its own, with the sources of Physics, Math and Petanque and Scene.cpp, as it replaces operator new:
+//  g++ -std=c++14 -O2 -pthread -I. -I../libs/vulkan_1.1.108.0/Include Bench/SolverAllocations.cpp Scene.cpp Physics/*.cpp Math/*.cpp Petanque/*.cpp
+//  (Physics/SphereBatchAVX.cpp and Physics/SphereBatchAVX512.cpp with -mavx and -mavx512f)
+//
+#include "../Scene.h"
+#include "../Physics/Shape.h"
+#include <atomic>
+#include <stdio.h>
+#include <stdlib.h>
+#include <new>
+
+static std::atomic< long > numAllocations( 0 );
+
+void * operator new( size_t size ) {
+	numAllocations++;
+	void * ptr = malloc( size > 0 ? size : 1 );
+	if ( ptr == NULL ) {
+		throw std::bad_alloc();
+	}
+	return ptr;
+}
+
+void * operator new[]( size_t size ) {
+	return operator new( size );
+}
+
+void operator delete( void * ptr ) noexcept {
+	free( ptr );
+}
+
+void operator delete[]( void * ptr ) noexcept {
+	operator delete( ptr );
+}
+
+void operator delete( void * ptr, size_t ) noexcept {
+	operator delete( ptr );
+}
+
+void operator delete[]( void * ptr, size_t ) noexcept {
+	operator delete( ptr );
+}
+
+// Boxes lying on the ground, far enough apart not to touch each other
+static const int numBoxesPerSide = 5;
+static const int numWarmUpSteps = 120;
+static const int numSteps = 600;
+static const float dt_sec = 1.0f / 60.0f;
+
+/*
+====================================================
+AddBox
+====================================================
+*/
+static BodyHandle AddBox( Scene & scene, const Vec3 & halfSize, const Vec3 & position, const float inverseMass ) {
+	const std::vector< Vec3 > corners = { halfSize * -1.0f, halfSize };
+
+	BodyData box;
+	box.position = position;
+	box.orientation = Quat( 0, 0, 0, 1 );
+	box.shape = new ShapeBox( corners, 2 );
+	box.inverseMass = inverseMass;
+	box.material.elasticity = 0.2f;
+	box.material.friction = 0.6f;
+	return scene.bodies.Create( box );
+}
+
+/*
+====================================================
+StartManifoldsCold
+
+Forgets the impulses of the last step, so every manifold goes through the
+dense solve of the block warm start, in the frame arena
+====================================================
+*/
+static void StartManifoldsCold( Scene & scene ) {
+	for ( const CollisionPair & pair : scene.broadPhase.GetPairs() ) {
+		CachedPair * cachedPair = scene.pairCache.Find( pair.a, pair.b );
+		if ( cachedPair == NULL ) {
+			continue;
+		}
+
+		ContactManifold & manifold = cachedPair->manifold;
+		for ( int i = 0; i < manifold.numPoints; i++ ) {
+			manifold.points[ i ].normalImpulse = 0.0f;
+			manifold.points[ i ].tangentImpulse[ 0 ] = 0.0f;
+			manifold.points[ i ].tangentImpulse[ 1 ] = 0.0f;
+		}
+	}
+}
+
+/*
+====================================================
+main
+====================================================
+*/
+int main( int argc, char * argv[] ) {
+	Scene * scene = new Scene;
+	scene->islands.solverType = ContactSolverType::SEQUENTIAL_IMPULSE;
+	scene->islands.allowSleep = false;
+
+	// Scratch memory of the worker threads warms up on the main thread
+	scene->narrowPhase.serial = true;
+	scene->islands.serial = true;
+
+	AddBox( *scene, Vec3( 20.0f, 20.0f, 0.5f ), Vec3( 0.0f, 0.0f, -0.5f ), 0.0f );
+	for ( int i = 0; i < numBoxesPerSide; i++ ) {
+		for ( int j = 0; j < numBoxesPerSide; j++ ) {
+			AddBox( *scene, Vec3( 0.5f ), Vec3( i * 2.0f, j * 2.0f, 0.51f ), 1.0f );
+		}
+	}
+
+	for ( int i = 0; i < numWarmUpSteps; i++ ) {
+		StartManifoldsCold( *scene );
+		scene->Update( dt_sec );
+	}
+
+	const long allocationsBefore = numAllocations;
+	const int arenaBlocksBefore = scene->frameArena.GetNumHeapAllocations();
+	size_t arenaBytes = 0;
+	for ( int i = 0; i < numSteps; i++ ) {
+		StartManifoldsCold( *scene );
+		scene->Update( dt_sec );
+		arenaBytes += scene->frameArena.GetUsed();
+	}
+	const long allocations = numAllocations - allocationsBefore;
+	const int arenaBlocks = scene->frameArena.GetNumHeapAllocations() - arenaBlocksBefore;
+
+	printf( "%d steps: %ld heap allocations, %d arena blocks, %.1f arena bytes per step\n",
+		numSteps, allocations, arenaBlocks, (float)arenaBytes / numSteps );
+
+	delete scene;
+
+	if ( allocations != 0 || arenaBlocks != 0 || arenaBytes == 0 ) {
+		printf( "FAILED\n" );
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,110 @@
+//
+//	FrameArena.cpp
+//
+#include "FrameArena.h"
+#include <stdlib.h>
+#include <stdint.h>
+#include <new>
+
+/*
+====================================================
+FrameArena
+====================================================
+*/
+FrameArena::FrameArena( size_t _capacity ) {
+	capacity = _capacity;
+	block = static_cast< char * >( malloc( capacity ) );
+	if ( block == NULL && capacity > 0 ) {
+		throw std::bad_alloc();
+	}
+	current = block;
+	currentCapacity = capacity;
+	offset = 0;
+	overflow = NULL;
+	used = 0;
+	highWater = 0;
+	numHeapAllocations = 1;
+}
+
+FrameArena::~FrameArena() {
+	FreeOverflow();
+	free( block );
+}
+
+void * FrameArena::Allocate( size_t size, size_t alignment ) {
+	std::lock_guard< std::mutex > lock( mutex );
+
+	uintptr_t address = reinterpret_cast< uintptr_t >( current ) + offset;
+	size_t padding = ( alignment - address % alignment ) % alignment;
+	if ( offset + padding + size > currentCapacity ) {
+		Grow( size, alignment );
+		address = reinterpret_cast< uintptr_t >( current ) + offset;
+		padding = ( alignment - address % alignment ) % alignment;
+	}
+
+	void * ptr = current + offset + padding;
+	offset += padding + size;
+	used += padding + size;
+	return ptr;
+}
+
+void FrameArena::Grow( size_t size, size_t alignment ) {
+	// Room for the header, the alignment and at least as much as the main block
+	const size_t header = sizeof( Overflow );
+	size_t blockCapacity = size + alignment;
+	if ( blockCapacity < capacity ) {
+		blockCapacity = capacity;
+	}
+
+	Overflow * next = static_cast< Overflow * >( malloc( header + blockCapacity ) );
+	if ( next == NULL ) {
+		throw std::bad_alloc();
+	}
+	next->previous = overflow;
+	next->capacity = blockCapacity;
+	overflow = next;
+	numHeapAllocations++;
+
+	current = reinterpret_cast< char * >( next ) + header;
+	currentCapacity = blockCapacity;
+	offset = 0;
+}
+
+void FrameArena::FreeOverflow() {
+	while ( overflow != NULL ) {
+		Overflow * previous = overflow->previous;
+		free( overflow );
+		overflow = previous;
+	}
+}
+
+void FrameArena::Reset() {
+	std::lock_guard< std::mutex > lock( mutex );
+
+	if ( used > highWater ) {
+		highWater = used;
+	}
+
+	if ( overflow != NULL ) {
+		FreeOverflow();
+
+		// Alignment is counted in the high water mark, the same frame fits in one block next time
+		free( block );
+		block = static_cast< char * >( malloc( highWater ) );
+		if ( block == NULL ) {
+			capacity = 0;
+			current = NULL;
+			currentCapacity = 0;
+			offset = 0;
+			used = 0;
+			throw std::bad_alloc();
+		}
+		capacity = highWater;
+		numHeapAllocations++;
+	}
+
+	current = block;
+	currentCapacity = capacity;
+	offset = 0;
+	used = 0;
+}
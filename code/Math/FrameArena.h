@@ -0,0 +1,62 @@
+//
+//	FrameArena.h
+//
+#pragma once
+#include <stddef.h>
+#include <mutex>
+
+/*
+====================================================
+FrameArena
+
+Bump allocator for memory only needed until the end of a frame.
+Allocations are never freed one by one, Reset releases all of them at once.
+A frame needing more than the block holds takes extra blocks from the heap,
+and the next Reset replaces the block by one big enough for all of them,
+so frames of the same size stop allocating after the first one.
+Allocate can be called from several threads at once, Reset only between
+frames. Running out of memory throws std::bad_alloc, like new.
+====================================================
+*/
+class FrameArena {
+public:
+	FrameArena( size_t capacity = 64 * 1024 );
+	~FrameArena();
+
+	FrameArena( const FrameArena & rhs ) = delete;
+	FrameArena & operator = ( const FrameArena & rhs ) = delete;
+
+	void * Allocate( size_t size, size_t alignment = 16 );
+
+	template< typename T >
+	T * Allocate( int count ) { return static_cast< T * >( Allocate( sizeof( T ) * count, alignof( T ) ) ); }
+
+	void Reset();
+
+	size_t GetCapacity() const { return capacity; }
+	// Bytes allocated since the last Reset, alignment included
+	size_t GetUsed() const { return used; }
+	// Blocks taken from the heap since the arena was created
+	int GetNumHeapAllocations() const { return numHeapAllocations; }
+
+private:
+	// Overflow blocks start with the previous one, the last one is the block allocations go to
+	struct Overflow {
+		Overflow *	previous;
+		size_t		capacity;
+	};
+
+	void Grow( size_t size, size_t alignment );
+	void FreeOverflow();
+
+	char *		block;
+	size_t		capacity;
+	char *		current;	// block or the last overflow block
+	size_t		currentCapacity;
+	size_t		offset;		// in current
+	Overflow *	overflow;
+	size_t		used;
+	size_t		highWater;
+	int			numHeapAllocations;
+	std::mutex	mutex;
+};
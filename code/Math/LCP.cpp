@@ -2,15 +2,18 @@
 //	LCP.cpp
 //
 #include "LCP.h"
+#include <algorithm>
+#include <math.h>
+#include <float.h>
+#include <xmmintrin.h>
 
 /*
 ====================================================
 LCP_GaussSeidel
 ====================================================
 */
-VecN LCP_GaussSeidel( const MatN & A, const VecN & b ) {
+static void LCP_GaussSeidelIterate( const MatN & A, const VecN & b, VecN & x ) {
 	const int N = b.N;
-	VecN x( N );
 	x.Zero();
 
 	for ( int iter = 0; iter < N; iter++ ) {
@@ -21,5 +24,467 @@ VecN LCP_GaussSeidel( const MatN & A, const VecN & b ) {
 			}
 		}
 	}
+}
+
+VecN LCP_GaussSeidel( const MatN & A, const VecN & b ) {
+	VecN x( b.N );
+	LCP_GaussSeidelIterate( A, b, x );
+	return x;
+}
+
+VecN LCP_GaussSeidel( const MatN & A, const VecN & b, FrameArena & arena ) {
+	VecN x( b.N, arena );
+	LCP_GaussSeidelIterate( A, b, x );
 	return x;
-}
\ No newline at end of file
+}
+/*
+====================================================
+LCP_SparseGaussSeidel
+====================================================
+*/
+static void LCP_ClampAngularSpeed( LCP_Body & body ) {
+	if ( body.maxAngularSpeed <= 0.0f ) {
+		return;
+	}
+
+	const float speedSqr = body.angularVelocity.GetLengthSqr();
+	if ( speedSqr > body.maxAngularSpeed * body.maxAngularSpeed ) {
+		body.angularVelocity *= body.maxAngularSpeed / sqrtf( speedSqr );
+	}
+}
+
+static void LCP_ApplyImpulse( std::vector< LCP_Body > & bodies, const LCP_Row & row, const float impulse ) {
+	LCP_Body & a = bodies[ row.bodyA ];
+	LCP_Body & b = bodies[ row.bodyB ];
+	a.linearVelocity += row.impulseLinearA * impulse;
+	a.angularVelocity += row.impulseAngularA * impulse;
+	b.linearVelocity += row.impulseLinearB * impulse;
+	b.angularVelocity += row.impulseAngularB * impulse;
+
+	LCP_ClampAngularSpeed( a );
+	LCP_ClampAngularSpeed( b );
+}
+
+// Caches M^-1 * J^T and the effective mass of the row, then applies the impulse it starts from
+static void LCP_PrepareRow( std::vector< LCP_Body > & bodies, LCP_Row & row ) {
+	const LCP_Body & a = bodies[ row.bodyA ];
+	const LCP_Body & b = bodies[ row.bodyB ];
+
+	row.impulseLinearA = row.linearA * a.inverseMass;
+	row.impulseAngularA = a.inverseInertia * row.angularA;
+	row.impulseLinearB = row.linearB * b.inverseMass;
+	row.impulseAngularB = b.inverseInertia * row.angularB;
+
+	const float inverseEffectiveMass = row.linearA.Dot( row.impulseLinearA ) + row.angularA.Dot( row.impulseAngularA )
+		+ row.linearB.Dot( row.impulseLinearB ) + row.angularB.Dot( row.impulseAngularB );
+	row.effectiveMass = inverseEffectiveMass > 0.0f ? 1.0f / inverseEffectiveMass : 0.0f;
+
+	LCP_ApplyImpulse( bodies, row, row.lambda );
+}
+
+// Solves one row against the current velocities, returns the change of its impulse
+static float LCP_SolveRow( std::vector< LCP_Body > & bodies, std::vector< LCP_Row > & rows, const int index ) {
+	LCP_Row & row = rows[ index ];
+	const LCP_Body & a = bodies[ row.bodyA ];
+	const LCP_Body & b = bodies[ row.bodyB ];
+
+	float lower = row.lower;
+	float upper = row.upper;
+	if ( row.normalRow >= 0 ) {
+		upper = row.friction * rows[ row.normalRow ].lambda;
+		lower = -upper;
+	}
+
+	const float jv = row.linearA.Dot( a.linearVelocity ) + row.angularA.Dot( a.angularVelocity )
+		+ row.linearB.Dot( b.linearVelocity ) + row.angularB.Dot( b.angularVelocity );
+	const float dx = ( row.rhs - jv ) * row.effectiveMass;
+
+	// The accumulated impulse is clamped, so a later iteration can take back what an earlier one did
+	const float oldLambda = row.lambda;
+	row.lambda = std::max( lower, std::min( oldLambda + dx, upper ) );
+	const float change = row.lambda - oldLambda;
+	LCP_ApplyImpulse( bodies, row, change );
+
+	return change;
+}
+
+int LCP_SparseGaussSeidel( std::vector< LCP_Body > & bodies, std::vector< LCP_Row > & rows, const int maxIterations, const float tolerance ) {
+	const int numRows = (int)rows.size();
+
+	for ( int i = 0; i < numRows; i++ ) {
+		LCP_PrepareRow( bodies, rows[ i ] );
+	}
+
+	int iter = 0;
+	while ( iter < maxIterations ) {
+		iter++;
+
+		float largestChange = 0.0f;
+		for ( int i = 0; i < numRows; i++ ) {
+			const float change = LCP_SolveRow( bodies, rows, i );
+			largestChange = std::max( largestChange, fabsf( change ) );
+		}
+
+		if ( largestChange <= tolerance ) {
+			break;
+		}
+	}
+	return iter;
+}
+
+/*
+====================================================
+LCP_ColorConstraints
+====================================================
+*/
+void LCP_ColorConstraints( const std::vector< LCP_Body > & bodies, const std::vector< LCP_Row > & rows, LCP_Coloring & coloring ) {
+	const int numRows = (int)rows.size();
+
+	coloring.firstRows.clear();
+	for ( int i = 0; i < numRows; i++ ) {
+		if ( i == 0 || rows[ i ].bodyA != rows[ i - 1 ].bodyA || rows[ i ].bodyB != rows[ i - 1 ].bodyB ) {
+			coloring.firstRows.push_back( i );
+		}
+	}
+	const int numConstraints = (int)coloring.firstRows.size();
+	coloring.firstRows.push_back( numRows );
+
+	coloring.bodyColors.assign( bodies.size(), 0 );
+	coloring.constraintColors.resize( numConstraints );
+
+	// Lowest color none of the two bodies has yet, so the first colors are the fullest
+	int counts[ LCP_MAX_COLORS + 1 ] = {};
+	int numColors = 0;
+	for ( int c = 0; c < numConstraints; c++ ) {
+		const LCP_Row & row = rows[ coloring.firstRows[ c ] ];
+		const bool writesA = bodies[ row.bodyA ].inverseMass != 0.0f;
+		const bool writesB = bodies[ row.bodyB ].inverseMass != 0.0f;
+
+		unsigned int used = 0;
+		if ( writesA ) {
+			used |= coloring.bodyColors[ row.bodyA ];
+		}
+		if ( writesB ) {
+			used |= coloring.bodyColors[ row.bodyB ];
+		}
+
+		int color = 0;
+		while ( color < LCP_MAX_COLORS && ( used & ( 1u << color ) ) != 0 ) {
+			color++;
+		}
+
+		if ( color < LCP_MAX_COLORS ) {
+			if ( writesA ) {
+				coloring.bodyColors[ row.bodyA ] |= 1u << color;
+			}
+			if ( writesB ) {
+				coloring.bodyColors[ row.bodyB ] |= 1u << color;
+			}
+			numColors = std::max( numColors, color + 1 );
+		}
+
+		coloring.constraintColors[ c ] = color;
+		counts[ color ]++;
+	}
+
+	int fill[ LCP_MAX_COLORS + 1 ];
+	int offset = 0;
+	coloring.numColors = numColors;
+	coloring.colorOffsets.resize( numColors + 1 );
+	for ( int color = 0; color < numColors; color++ ) {
+		coloring.colorOffsets[ color ] = offset;
+		fill[ color ] = offset;
+		offset += counts[ color ];
+	}
+	coloring.colorOffsets[ numColors ] = offset;
+	fill[ LCP_MAX_COLORS ] = offset;
+
+	coloring.constraints.resize( numConstraints );
+	for ( int c = 0; c < numConstraints; c++ ) {
+		coloring.constraints[ fill[ coloring.constraintColors[ c ] ]++ ] = c;
+	}
+
+	// Constraints of the same size next to each other, so few lanes are padded
+	const int * firstRows = coloring.firstRows.data();
+	for ( int color = 0; color < numColors; color++ ) {
+		std::sort( coloring.constraints.begin() + coloring.colorOffsets[ color ], coloring.constraints.begin() + coloring.colorOffsets[ color + 1 ],
+			[ firstRows ]( const int lhs, const int rhs ) {
+				const int lhsRows = firstRows[ lhs + 1 ] - firstRows[ lhs ];
+				const int rhsRows = firstRows[ rhs + 1 ] - firstRows[ rhs ];
+				if ( lhsRows != rhsRows ) {
+					return lhsRows > rhsRows;
+				}
+				return lhs < rhs;
+			} );
+	}
+}
+
+/*
+====================================================
+LCP_SparseGaussSeidelColored
+====================================================
+*/
+static void LCP_StoreLane( LCP_RowLanes & lanes, const int lane, const LCP_Row & row, const int firstRow ) {
+	for ( int k = 0; k < 3; k++ ) {
+		lanes.linearA[ k ][ lane ] = row.linearA[ k ];
+		lanes.angularA[ k ][ lane ] = row.angularA[ k ];
+		lanes.linearB[ k ][ lane ] = row.linearB[ k ];
+		lanes.angularB[ k ][ lane ] = row.angularB[ k ];
+		lanes.impulseLinearA[ k ][ lane ] = row.impulseLinearA[ k ];
+		lanes.impulseAngularA[ k ][ lane ] = row.impulseAngularA[ k ];
+		lanes.impulseLinearB[ k ][ lane ] = row.impulseLinearB[ k ];
+		lanes.impulseAngularB[ k ][ lane ] = row.impulseAngularB[ k ];
+	}
+
+	lanes.rhs[ lane ] = row.rhs;
+	lanes.lower[ lane ] = row.lower;
+	lanes.upper[ lane ] = row.upper;
+	lanes.friction[ lane ] = row.friction;
+	lanes.effectiveMass[ lane ] = row.effectiveMass;
+	lanes.lambda[ lane ] = row.lambda;
+	lanes.normalOffset[ lane ] = row.normalRow >= 0 ? row.normalRow - firstRow : -1;
+	lanes.bodyA[ lane ] = row.bodyA;
+	lanes.bodyB[ lane ] = row.bodyB;
+}
+
+// Row doing nothing, for the lanes of a constraint with fewer rows than the others of its group
+static void LCP_PadLane( LCP_RowLanes & lanes, const int lane, const LCP_Row & firstRow ) {
+	for ( int k = 0; k < 3; k++ ) {
+		lanes.linearA[ k ][ lane ] = 0.0f;
+		lanes.angularA[ k ][ lane ] = 0.0f;
+		lanes.linearB[ k ][ lane ] = 0.0f;
+		lanes.angularB[ k ][ lane ] = 0.0f;
+		lanes.impulseLinearA[ k ][ lane ] = 0.0f;
+		lanes.impulseAngularA[ k ][ lane ] = 0.0f;
+		lanes.impulseLinearB[ k ][ lane ] = 0.0f;
+		lanes.impulseAngularB[ k ][ lane ] = 0.0f;
+	}
+
+	lanes.rhs[ lane ] = 0.0f;
+	lanes.lower[ lane ] = 0.0f;
+	lanes.upper[ lane ] = 0.0f;
+	lanes.friction[ lane ] = 0.0f;
+	lanes.effectiveMass[ lane ] = 0.0f;
+	lanes.lambda[ lane ] = 0.0f;
+	lanes.normalOffset[ lane ] = -1;
+	lanes.bodyA[ lane ] = firstRow.bodyA;
+	lanes.bodyB[ lane ] = firstRow.bodyB;
+}
+
+static inline __m128 LCP_Dot( const float ( &jacobian )[ 3 ][ LCP_LANES ], const __m128 velocity[ 3 ] ) {
+	__m128 dot = _mm_mul_ps( _mm_load_ps( jacobian[ 0 ] ), velocity[ 0 ] );
+	dot = _mm_add_ps( dot, _mm_mul_ps( _mm_load_ps( jacobian[ 1 ] ), velocity[ 1 ] ) );
+	dot = _mm_add_ps( dot, _mm_mul_ps( _mm_load_ps( jacobian[ 2 ] ), velocity[ 2 ] ) );
+	return dot;
+}
+
+static inline void LCP_AddImpulse( __m128 velocity[ 3 ], const float ( &impulse )[ 3 ][ LCP_LANES ], const __m128 change ) {
+	for ( int k = 0; k < 3; k++ ) {
+		velocity[ k ] = _mm_add_ps( velocity[ k ], _mm_mul_ps( _mm_load_ps( impulse[ k ] ), change ) );
+	}
+}
+
+// Same as LCP_ClampAngularSpeed on every lane, lanes without a limit have a max speed of FLT_MAX
+static inline void LCP_ClampAngularSpeedLanes( __m128 angularVelocity[ 3 ], const __m128 maxSpeed ) {
+	__m128 speedSqr = _mm_mul_ps( angularVelocity[ 0 ], angularVelocity[ 0 ] );
+	speedSqr = _mm_add_ps( speedSqr, _mm_mul_ps( angularVelocity[ 1 ], angularVelocity[ 1 ] ) );
+	speedSqr = _mm_add_ps( speedSqr, _mm_mul_ps( angularVelocity[ 2 ], angularVelocity[ 2 ] ) );
+
+	const __m128 tooFast = _mm_cmpgt_ps( speedSqr, _mm_mul_ps( maxSpeed, maxSpeed ) );
+	if ( _mm_movemask_ps( tooFast ) == 0 ) {
+		return;
+	}
+
+	const __m128 scale = _mm_div_ps( maxSpeed, _mm_sqrt_ps( speedSqr ) );
+	const __m128 factor = _mm_or_ps( _mm_and_ps( tooFast, scale ), _mm_andnot_ps( tooFast, _mm_set1_ps( 1.0f ) ) );
+	for ( int k = 0; k < 3; k++ ) {
+		angularVelocity[ k ] = _mm_mul_ps( angularVelocity[ k ], factor );
+	}
+}
+
+// Solves the rows of LCP_LANES constraints at once, returns the largest change of their impulses
+static float LCP_SolveLanesSSE( std::vector< LCP_Body > & bodies, LCP_RowLanes * blocks, const int numBlocks ) {
+	// The constraints of a color don't share bodies, every lane reads and writes its own two
+	alignas( 16 ) float velocities[ 4 ][ 3 ][ LCP_LANES ];
+	alignas( 16 ) float maxSpeeds[ 2 ][ LCP_LANES ];
+	for ( int lane = 0; lane < LCP_LANES; lane++ ) {
+		const LCP_Body & a = bodies[ blocks[ 0 ].bodyA[ lane ] ];
+		const LCP_Body & b = bodies[ blocks[ 0 ].bodyB[ lane ] ];
+		for ( int k = 0; k < 3; k++ ) {
+			velocities[ 0 ][ k ][ lane ] = a.linearVelocity[ k ];
+			velocities[ 1 ][ k ][ lane ] = a.angularVelocity[ k ];
+			velocities[ 2 ][ k ][ lane ] = b.linearVelocity[ k ];
+			velocities[ 3 ][ k ][ lane ] = b.angularVelocity[ k ];
+		}
+		maxSpeeds[ 0 ][ lane ] = a.maxAngularSpeed > 0.0f ? a.maxAngularSpeed : FLT_MAX;
+		maxSpeeds[ 1 ][ lane ] = b.maxAngularSpeed > 0.0f ? b.maxAngularSpeed : FLT_MAX;
+	}
+
+	__m128 linearA[ 3 ], angularA[ 3 ], linearB[ 3 ], angularB[ 3 ];
+	for ( int k = 0; k < 3; k++ ) {
+		linearA[ k ] = _mm_load_ps( velocities[ 0 ][ k ] );
+		angularA[ k ] = _mm_load_ps( velocities[ 1 ][ k ] );
+		linearB[ k ] = _mm_load_ps( velocities[ 2 ][ k ] );
+		angularB[ k ] = _mm_load_ps( velocities[ 3 ][ k ] );
+	}
+	const __m128 maxSpeedA = _mm_load_ps( maxSpeeds[ 0 ] );
+	const __m128 maxSpeedB = _mm_load_ps( maxSpeeds[ 1 ] );
+	const __m128 signMask = _mm_set1_ps( -0.0f );
+
+	__m128 largestChange = _mm_setzero_ps();
+	for ( int r = 0; r < numBlocks; r++ ) {
+		LCP_RowLanes & row = blocks[ r ];
+
+		alignas( 16 ) float lowers[ LCP_LANES ];
+		alignas( 16 ) float uppers[ LCP_LANES ];
+		for ( int lane = 0; lane < LCP_LANES; lane++ ) {
+			const int normalOffset = row.normalOffset[ lane ];
+			if ( normalOffset >= 0 ) {
+				uppers[ lane ] = row.friction[ lane ] * blocks[ normalOffset ].lambda[ lane ];
+				lowers[ lane ] = -uppers[ lane ];
+			} else {
+				uppers[ lane ] = row.upper[ lane ];
+				lowers[ lane ] = row.lower[ lane ];
+			}
+		}
+
+		__m128 jv = LCP_Dot( row.linearA, linearA );
+		jv = _mm_add_ps( jv, LCP_Dot( row.angularA, angularA ) );
+		jv = _mm_add_ps( jv, LCP_Dot( row.linearB, linearB ) );
+		jv = _mm_add_ps( jv, LCP_Dot( row.angularB, angularB ) );
+		const __m128 dx = _mm_mul_ps( _mm_sub_ps( _mm_load_ps( row.rhs ), jv ), _mm_load_ps( row.effectiveMass ) );
+
+		const __m128 oldLambda = _mm_load_ps( row.lambda );
+		const __m128 lambda = _mm_max_ps( _mm_load_ps( lowers ), _mm_min_ps( _mm_add_ps( oldLambda, dx ), _mm_load_ps( uppers ) ) );
+		_mm_store_ps( row.lambda, lambda );
+		const __m128 change = _mm_sub_ps( lambda, oldLambda );
+
+		LCP_AddImpulse( linearA, row.impulseLinearA, change );
+		LCP_AddImpulse( angularA, row.impulseAngularA, change );
+		LCP_AddImpulse( linearB, row.impulseLinearB, change );
+		LCP_AddImpulse( angularB, row.impulseAngularB, change );
+		LCP_ClampAngularSpeedLanes( angularA, maxSpeedA );
+		LCP_ClampAngularSpeedLanes( angularB, maxSpeedB );
+
+		largestChange = _mm_max_ps( largestChange, _mm_andnot_ps( signMask, change ) );
+	}
+
+	for ( int k = 0; k < 3; k++ ) {
+		_mm_store_ps( velocities[ 0 ][ k ], linearA[ k ] );
+		_mm_store_ps( velocities[ 1 ][ k ], angularA[ k ] );
+		_mm_store_ps( velocities[ 2 ][ k ], linearB[ k ] );
+		_mm_store_ps( velocities[ 3 ][ k ], angularB[ k ] );
+	}
+	for ( int lane = 0; lane < LCP_LANES; lane++ ) {
+		LCP_Body & a = bodies[ blocks[ 0 ].bodyA[ lane ] ];
+		LCP_Body & b = bodies[ blocks[ 0 ].bodyB[ lane ] ];
+		a.linearVelocity = Vec3( velocities[ 0 ][ 0 ][ lane ], velocities[ 0 ][ 1 ][ lane ], velocities[ 0 ][ 2 ][ lane ] );
+		a.angularVelocity = Vec3( velocities[ 1 ][ 0 ][ lane ], velocities[ 1 ][ 1 ][ lane ], velocities[ 1 ][ 2 ][ lane ] );
+		b.linearVelocity = Vec3( velocities[ 2 ][ 0 ][ lane ], velocities[ 2 ][ 1 ][ lane ], velocities[ 2 ][ 2 ][ lane ] );
+		b.angularVelocity = Vec3( velocities[ 3 ][ 0 ][ lane ], velocities[ 3 ][ 1 ][ lane ], velocities[ 3 ][ 2 ][ lane ] );
+	}
+
+	alignas( 16 ) float changes[ LCP_LANES ];
+	_mm_store_ps( changes, largestChange );
+	return std::max( std::max( changes[ 0 ], changes[ 1 ] ), std::max( changes[ 2 ], changes[ 3 ] ) );
+}
+
+// Rows of a group of lanes are the ones of its first constraint, the largest
+static int LCP_NumGroupRows( const LCP_Coloring & coloring, const int firstConstraint ) {
+	const int constraint = coloring.constraints[ firstConstraint ];
+	return coloring.firstRows[ constraint + 1 ] - coloring.firstRows[ constraint ];
+}
+
+int LCP_SparseGaussSeidelColored( std::vector< LCP_Body > & bodies, std::vector< LCP_Row > & rows, LCP_Coloring & coloring, const int maxIterations, const float tolerance ) {
+	const int numRows = (int)rows.size();
+	const int numColors = coloring.numColors;
+	const int numConstraints = (int)coloring.constraints.size();
+	const int * constraints = coloring.constraints.data();
+	const int * colorOffsets = coloring.colorOffsets.data();
+	const int * firstRows = coloring.firstRows.data();
+
+	for ( int i = 0; i < numRows; i++ ) {
+		LCP_PrepareRow( bodies, rows[ i ] );
+	}
+
+	// Full groups of lanes of every color move to the lanes, the rows keep the rest
+	int numLaneRows = 0;
+	for ( int color = 0; color < numColors; color++ ) {
+		const int numFull = ( colorOffsets[ color + 1 ] - colorOffsets[ color ] ) / LCP_LANES * LCP_LANES;
+		for ( int c = 0; c < numFull; c += LCP_LANES ) {
+			numLaneRows += LCP_NumGroupRows( coloring, colorOffsets[ color ] + c );
+		}
+	}
+	coloring.lanes.resize( numLaneRows );
+	LCP_RowLanes * lanes = coloring.lanes.data();
+
+	int laneRow = 0;
+	for ( int color = 0; color < numColors; color++ ) {
+		const int numFull = ( colorOffsets[ color + 1 ] - colorOffsets[ color ] ) / LCP_LANES * LCP_LANES;
+		for ( int c = 0; c < numFull; c += LCP_LANES ) {
+			const int numGroupRows = LCP_NumGroupRows( coloring, colorOffsets[ color ] + c );
+			for ( int lane = 0; lane < LCP_LANES; lane++ ) {
+				const int constraint = constraints[ colorOffsets[ color ] + c + lane ];
+				const int firstRow = firstRows[ constraint ];
+				const int numConstraintRows = firstRows[ constraint + 1 ] - firstRow;
+				for ( int k = 0; k < numGroupRows; k++ ) {
+					if ( k < numConstraintRows ) {
+						LCP_StoreLane( lanes[ laneRow + k ], lane, rows[ firstRow + k ], firstRow );
+					} else {
+						LCP_PadLane( lanes[ laneRow + k ], lane, rows[ firstRow ] );
+					}
+				}
+			}
+			laneRow += numGroupRows;
+		}
+	}
+
+	int iter = 0;
+	while ( iter < maxIterations ) {
+		iter++;
+
+		float largestChange = 0.0f;
+		laneRow = 0;
+		for ( int color = 0; color < numColors; color++ ) {
+			const int first = colorOffsets[ color ];
+			const int count = colorOffsets[ color + 1 ] - first;
+			const int numFull = count / LCP_LANES * LCP_LANES;
+			for ( int c = 0; c < numFull; c += LCP_LANES ) {
+				const int numGroupRows = LCP_NumGroupRows( coloring, first + c );
+				const float change = LCP_SolveLanesSSE( bodies, &lanes[ laneRow ], numGroupRows );
+				largestChange = std::max( largestChange, change );
+				laneRow += numGroupRows;
+			}
+
+			// Constraints left over after the groups, and the ones without a color that may share bodies, are solved in order
+			const int last = color == numColors - 1 ? numConstraints : first + count;
+			for ( int c = first + numFull; c < last; c++ ) {
+				for ( int i = firstRows[ constraints[ c ] ]; i < firstRows[ constraints[ c ] + 1 ]; i++ ) {
+					const float change = LCP_SolveRow( bodies, rows, i );
+					largestChange = std::max( largestChange, fabsf( change ) );
+				}
+			}
+		}
+
+		if ( largestChange <= tolerance ) {
+			break;
+		}
+	}
+
+	// Impulses solved in lanes go back to their rows
+	laneRow = 0;
+	for ( int color = 0; color < numColors; color++ ) {
+		const int numFull = ( colorOffsets[ color + 1 ] - colorOffsets[ color ] ) / LCP_LANES * LCP_LANES;
+		for ( int c = 0; c < numFull; c += LCP_LANES ) {
+			const int numGroupRows = LCP_NumGroupRows( coloring, colorOffsets[ color ] + c );
+			for ( int lane = 0; lane < LCP_LANES; lane++ ) {
+				const int constraint = constraints[ colorOffsets[ color ] + c + lane ];
+				for ( int i = firstRows[ constraint ]; i < firstRows[ constraint + 1 ]; i++ ) {
+					rows[ i ].lambda = lanes[ laneRow + i - firstRows[ constraint ] ].lambda[ lane ];
+				}
+			}
+			laneRow += numGroupRows;
+		}
+	}
+	return iter;
+}
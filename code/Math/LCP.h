@@ -2,6 +2,7 @@
 //	LCP.h
 //
 #pragma once
+#include <vector>
 #include "Vector.h"
 #include "Matrix.h"
 
@@ -11,4 +12,156 @@
 LCP_GaussSeidel
 ====================================================
 */
-VecN LCP_GaussSeidel( const MatN & A, const VecN & b );
\ No newline at end of file
+VecN LCP_GaussSeidel( const MatN & A, const VecN & b );
+
+// Same solve with x taken from the arena, nothing is allocated on the heap
+VecN LCP_GaussSeidel( const MatN & A, const VecN & b, FrameArena & arena );
+
+// Same solve for systems with a size known at compile time
+template< int SIZE >
+VecFixedN< SIZE > LCP_GaussSeidel( const MatFixedN< SIZE > & A, const VecFixedN< SIZE > & b ) {
+	VecFixedN< SIZE > x;
+	x.Zero();
+
+	for ( int iter = 0; iter < SIZE; iter++ ) {
+		for ( int i = 0; i < SIZE; i++ ) {
+			float dx = ( b[ i ] - A.rows[ i ].Dot( x ) ) / A.rows[ i ][ i ];
+			if ( dx * 0.0f == dx * 0.0f ) {
+				x[ i ] = x[ i ] + dx;
+			}
+		}
+	}
+	return x;
+}
+
+/*
+====================================================
+LCP_SparseGaussSeidel
+
+Projected Gauss-Seidel over constraints coupling at most two bodies.
+A = J * M^-1 * J^T is never built: every row keeps its Jacobian blocks for its two bodies,
+and solving a row only reads and writes the velocities of these two bodies.
+Rows are solved in order, so a friction row bounded by a normal row should come before it
+and is bounded by the impulse the normal row had at the end of the last iteration.
+====================================================
+*/
+
+// Velocities and inverse mass of one body, as the solver sees it
+struct LCP_Body {
+	Vec3 linearVelocity;
+	Vec3 angularVelocity;
+	float inverseMass;
+	Mat3 inverseInertia;	// world space, the inverse mass already applied
+	float maxAngularSpeed;	// the angular velocity is clamped to it after every impulse, 0 for no limit
+};
+
+// One row of J * v >= rhs, bounded impulse lambda
+struct LCP_Row {
+	int bodyA;
+	int bodyB;
+
+	// Jacobian blocks of both bodies
+	Vec3 linearA;
+	Vec3 angularA;
+	Vec3 linearB;
+	Vec3 angularB;
+
+	float rhs;
+	float lower;
+	float upper;
+
+	// Friction rows are bounded by friction times the impulse of the row normalRow, which must be >= 0
+	int normalRow;
+	float friction;
+
+	// Impulse accumulated over the iterations, the solver starts from its value
+	float lambda;
+
+	// Filled by the solver: M^-1 * J^T of both bodies and the inverse of J * M^-1 * J^T
+	Vec3 impulseLinearA;
+	Vec3 impulseAngularA;
+	Vec3 impulseLinearB;
+	Vec3 impulseAngularB;
+	float effectiveMass;
+};
+
+/*
+Applies the impulses the rows start from, then iterates until no lambda changes
+by more than tolerance or maxIterations is reached. Returns the number of iterations done.
+*/
+int LCP_SparseGaussSeidel( std::vector< LCP_Body > & bodies, std::vector< LCP_Row > & rows, const int maxIterations, const float tolerance );
+
+/*
+====================================================
+LCP_ColorConstraints
+
+Greedy coloring of the constraint graph, bodies being its nodes and constraints its edges.
+A constraint is a run of consecutive rows on the same two bodies, like the rows of a contact manifold.
+No body with a finite mass is in two constraints of the same color: the constraints of a color
+can be solved in any order, several at once in SIMD lanes or on several threads without locks,
+and solving the colors one after the other still converges like Gauss-Seidel.
+Bodies with an infinite mass are never written to, they can be in any number of constraints of a color.
+====================================================
+*/
+
+// Colors given before the constraints left go to a last group solved one at a time
+static const int LCP_MAX_COLORS = 32;
+
+// Constraints solved together by LCP_SparseGaussSeidelColored
+static const int LCP_LANES = 4;
+
+// Rows of the same place in LCP_LANES constraints of a color, one array entry per lane.
+// Lanes of constraints with fewer rows are padded with rows that never change.
+struct alignas( 16 ) LCP_RowLanes {
+	float linearA[ 3 ][ LCP_LANES ];
+	float angularA[ 3 ][ LCP_LANES ];
+	float linearB[ 3 ][ LCP_LANES ];
+	float angularB[ 3 ][ LCP_LANES ];
+	float impulseLinearA[ 3 ][ LCP_LANES ];
+	float impulseAngularA[ 3 ][ LCP_LANES ];
+	float impulseLinearB[ 3 ][ LCP_LANES ];
+	float impulseAngularB[ 3 ][ LCP_LANES ];
+
+	float rhs[ LCP_LANES ];
+	float lower[ LCP_LANES ];
+	float upper[ LCP_LANES ];
+	float friction[ LCP_LANES ];
+	float effectiveMass[ LCP_LANES ];
+	float lambda[ LCP_LANES ];
+
+	// Row of the constraint bounding a friction row, -1 for none
+	int normalOffset[ LCP_LANES ];
+	int bodyA[ LCP_LANES ];
+	int bodyB[ LCP_LANES ];
+};
+
+struct LCP_Coloring {
+	// Rows of constraint c are rows[ firstRows[ c ] ] to rows[ firstRows[ c + 1 ] - 1 ]
+	std::vector< int > firstRows;
+
+	// Constraints color after color, the largest first within a color, the ones left over last
+	std::vector< int > constraints;
+	// Constraints of color c are constraints[ colorOffsets[ c ] ] to constraints[ colorOffsets[ c + 1 ] - 1 ],
+	// colorOffsets[ numColors ] being the first constraint left over
+	std::vector< int > colorOffsets;
+	int numColors;
+
+	// Filled by LCP_SparseGaussSeidelColored: the rows of every full group of lanes of a color, one group after the other
+	std::vector< LCP_RowLanes > lanes;
+
+	// Colors already given to every body, one bit per color
+	std::vector< unsigned int > bodyColors;
+	// Color of every constraint, LCP_MAX_COLORS for the ones left over
+	std::vector< int > constraintColors;
+};
+
+/*
+Friction rows must be bounded by a normal row of their own constraint.
+*/
+void LCP_ColorConstraints( const std::vector< LCP_Body > & bodies, const std::vector< LCP_Row > & rows, LCP_Coloring & coloring );
+
+/*
+Same solve as LCP_SparseGaussSeidel, color after color: full groups of LCP_LANES constraints
+of a color are solved at once with SSE, the rest of the color and the constraints left over one at a time.
+*/
+int LCP_SparseGaussSeidelColored( std::vector< LCP_Body > & bodies, std::vector< LCP_Row > & rows, LCP_Coloring & coloring, const int maxIterations, const float tolerance );
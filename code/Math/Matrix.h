@@ -3,6 +3,8 @@
 //
 #pragma once
 #include "Vector.h"
+#include <new>
+#include <utility>
 
 /*
 ====================================================
@@ -545,14 +547,17 @@ MatMN
 */
 class MatMN {
 public:
-	MatMN() : M( 0 ), N( 0 ) {}
+	MatMN() : M( 0 ), N( 0 ), rows( NULL ), ownsRows( true ) {}
 	MatMN( int M, int N );
-	MatMN( const MatMN & rhs ) {
+	MatMN( int M, int N, FrameArena & arena );
+	MatMN( const MatMN & rhs ) : M( 0 ), N( 0 ), rows( NULL ), ownsRows( true ) {
 		*this = rhs;
 	}
-	~MatMN() { delete[] rows; }
+	MatMN( MatMN && rhs );
+	~MatMN() { Release(); }
 
 	const MatMN & operator = ( const MatMN & rhs );
+	const MatMN & operator = ( MatMN && rhs );
 	const MatMN & operator *= ( float rhs );
 	VecN operator * ( const VecN & rhs ) const;
 	MatMN operator * ( const MatMN & rhs ) const;
@@ -561,31 +566,100 @@ public:
 	void Zero();
 	MatMN Transpose() const;
 
+private:
+	void Release();
+
 public:
 	int		M;	// M rows
 	int		N;	// N columns
 	VecN *	rows;
+	bool	ownsRows;	// false when the rows live in a FrameArena
 };
 
 inline MatMN::MatMN( int _M, int _N ) {
 	M = _M;
 	N = _N;
 	rows = new VecN[ M ];
+	ownsRows = true;
 	for ( int m = 0; m < M; m++ ) {
 		rows[ m ] = VecN( N );
 	}
 }
 
-inline const MatMN & MatMN::operator = ( const MatMN & rhs ) {
+// The rows and their data are only valid until the next Reset of the arena
+inline MatMN::MatMN( int _M, int _N, FrameArena & arena ) {
+	M = _M;
+	N = _N;
+	rows = arena.Allocate< VecN >( M );
+	ownsRows = false;
+	for ( int m = 0; m < M; m++ ) {
+		new ( &rows[ m ] ) VecN( N, arena );
+	}
+}
+
+inline MatMN::MatMN( MatMN && rhs ) {
 	M = rhs.M;
 	N = rhs.N;
-	rows = new VecN[ M ];
+	rows = rhs.rows;
+	ownsRows = rhs.ownsRows;
+	rhs.M = 0;
+	rhs.N = 0;
+	rhs.rows = NULL;
+	rhs.ownsRows = true;
+}
+
+inline const MatMN & MatMN::operator = ( const MatMN & rhs ) {
+	if ( this == &rhs ) {
+		return *this;
+	}
+
+	// Matrices of the same size keep their rows
+	if ( M != rhs.M || N != rhs.N || rows == NULL ) {
+		Release();
+		M = rhs.M;
+		N = rhs.N;
+		rows = new VecN[ M ];
+		ownsRows = true;
+	}
+
 	for ( int m = 0; m < M; m++ ) {
 		rows[ m ] = rhs.rows[ m ];
 	}
 	return *this;
 }
 
+inline const MatMN & MatMN::operator = ( MatMN && rhs ) {
+	if ( this == &rhs ) {
+		return *this;
+	}
+
+	Release();
+	M = rhs.M;
+	N = rhs.N;
+	rows = rhs.rows;
+	ownsRows = rhs.ownsRows;
+	rhs.M = 0;
+	rhs.N = 0;
+	rhs.rows = NULL;
+	rhs.ownsRows = true;
+	return *this;
+}
+
+inline void MatMN::Release() {
+	if ( ownsRows ) {
+		delete[] rows;
+	} else {
+		// The arena runs no destructors, and rows resized since then own heap data
+		for ( int m = 0; m < M; m++ ) {
+			rows[ m ].~VecN();
+		}
+	}
+	M = 0;
+	N = 0;
+	rows = NULL;
+	ownsRows = true;
+}
+
 inline const MatMN & MatMN::operator *= ( float rhs ) {
 	for ( int m = 0; m < M; m++ ) {
 		rows[ m ] *= rhs;
@@ -656,17 +730,20 @@ MatN
 */
 class MatN {
 public:
-	MatN() : numDimensions( 0 ) {}
+	MatN() : numDimensions( 0 ), rows( NULL ), ownsRows( true ) {}
 	MatN( int N );
-	MatN( const MatN & rhs ) {
+	MatN( int N, FrameArena & arena );
+	MatN( const MatN & rhs ) : numDimensions( 0 ), rows( NULL ), ownsRows( true ) {
 		*this = rhs;
 	}
-	MatN( const MatMN & rhs ) {
+	MatN( MatN && rhs );
+	MatN( const MatMN & rhs ) : numDimensions( 0 ), rows( NULL ), ownsRows( true ) {
 		*this = rhs;
 	}
-	~MatN() { delete[] rows; }
+	~MatN() { Release(); }
 
 	const MatN & operator = ( const MatN & rhs );
+	const MatN & operator = ( MatN && rhs );
 	const MatN & operator = ( const MatMN & rhs );
 
 	void Identity();
@@ -677,41 +754,109 @@ public:
 	VecN operator * ( const VecN & rhs );
 	MatN operator * ( const MatN & rhs );
 
+private:
+	void Resize( int N );
+	void Release();
+
 public:
 	int		numDimensions;
 	VecN *	rows;
+	bool	ownsRows;	// false when the rows live in a FrameArena
 };
 
 inline MatN::MatN( int N ) {
 	numDimensions = N;
 	rows = new VecN[ N ];
+	ownsRows = true;
 	for ( int i = 0; i < N; i++ ) {
 		rows[ i ] = VecN( N );
 	}
 }
 
-inline const MatN & MatN::operator = ( const MatN & rhs ) {
+// The rows and their data are only valid until the next Reset of the arena
+inline MatN::MatN( int N, FrameArena & arena ) {
+	numDimensions = N;
+	rows = arena.Allocate< VecN >( N );
+	ownsRows = false;
+	for ( int i = 0; i < N; i++ ) {
+		new ( &rows[ i ] ) VecN( N, arena );
+	}
+}
+
+inline MatN::MatN( MatN && rhs ) {
 	numDimensions = rhs.numDimensions;
-	rows = new VecN[ numDimensions ];
+	rows = rhs.rows;
+	ownsRows = rhs.ownsRows;
+	rhs.numDimensions = 0;
+	rhs.rows = NULL;
+	rhs.ownsRows = true;
+}
+
+inline const MatN & MatN::operator = ( const MatN & rhs ) {
+	if ( this == &rhs ) {
+		return *this;
+	}
+
+	Resize( rhs.numDimensions );
 	for ( int i = 0; i < numDimensions; i++ ) {
 		rows[ i ] = rhs.rows[ i ];
 	}
 	return *this;
 }
 
+inline const MatN & MatN::operator = ( MatN && rhs ) {
+	if ( this == &rhs ) {
+		return *this;
+	}
+
+	Release();
+	numDimensions = rhs.numDimensions;
+	rows = rhs.rows;
+	ownsRows = rhs.ownsRows;
+	rhs.numDimensions = 0;
+	rhs.rows = NULL;
+	rhs.ownsRows = true;
+	return *this;
+}
+
 inline const MatN & MatN::operator = ( const MatMN & rhs ) {
 	if ( rhs.M != rhs.N ) {
 		return *this;
 	}
 
-	numDimensions = rhs.N;
-	rows = new VecN[ numDimensions ];
+	Resize( rhs.N );
 	for ( int i = 0; i < numDimensions; i++ ) {
 		rows[ i ] = rhs.rows[ i ];
 	}
 	return *this;
 }
 
+// Matrices of the same size keep their rows
+inline void MatN::Resize( int N ) {
+	if ( numDimensions == N && rows != NULL ) {
+		return;
+	}
+
+	Release();
+	numDimensions = N;
+	rows = new VecN[ N ];
+	ownsRows = true;
+}
+
+inline void MatN::Release() {
+	if ( ownsRows ) {
+		delete[] rows;
+	} else {
+		// The arena runs no destructors, and rows resized since then own heap data
+		for ( int i = 0; i < numDimensions; i++ ) {
+			rows[ i ].~VecN();
+		}
+	}
+	numDimensions = 0;
+	rows = NULL;
+	ownsRows = true;
+}
+
 inline void MatN::Zero() {
 	for ( int i = 0; i < numDimensions; i++ ) {
 		rows[ i ].Zero();
@@ -734,7 +879,7 @@ inline void MatN::Transpose() {
 		}
 	}
 
-	*this = tmp;
+	*this = std::move( tmp );
 }
 
 inline void MatN::operator *= ( float rhs ) {
@@ -764,4 +909,87 @@ inline MatN MatN::operator * ( const MatN & rhs ) {
 	}
 
 	return tmp;
-}
\ No newline at end of file
+}
+
+/*
+====================================================
+MatFixedN
+
+MatN with its size known at compile time, for small systems.
+The rows are members, nothing is allocated.
+====================================================
+*/
+template< int SIZE >
+class MatFixedN {
+public:
+	MatFixedN() {}
+
+	void Identity();
+	void Zero();
+	void Transpose();
+
+	void operator *= ( float rhs );
+	VecFixedN< SIZE > operator * ( const VecFixedN< SIZE > & rhs ) const;
+	MatFixedN operator * ( const MatFixedN & rhs ) const;
+
+public:
+	static const int numDimensions = SIZE;
+	VecFixedN< SIZE >	rows[ SIZE ];
+};
+
+template< int SIZE >
+inline void MatFixedN< SIZE >::Zero() {
+	for ( int i = 0; i < SIZE; i++ ) {
+		rows[ i ].Zero();
+	}
+}
+
+template< int SIZE >
+inline void MatFixedN< SIZE >::Identity() {
+	for ( int i = 0; i < SIZE; i++ ) {
+		rows[ i ].Zero();
+		rows[ i ][ i ] = 1.0f;
+	}
+}
+
+template< int SIZE >
+inline void MatFixedN< SIZE >::Transpose() {
+	for ( int i = 0; i < SIZE; i++ ) {
+		for ( int j = i + 1; j < SIZE; j++ ) {
+			const float tmp = rows[ i ][ j ];
+			rows[ i ][ j ] = rows[ j ][ i ];
+			rows[ j ][ i ] = tmp;
+		}
+	}
+}
+
+template< int SIZE >
+inline void MatFixedN< SIZE >::operator *= ( float rhs ) {
+	for ( int i = 0; i < SIZE; i++ ) {
+		rows[ i ] *= rhs;
+	}
+}
+
+template< int SIZE >
+inline VecFixedN< SIZE > MatFixedN< SIZE >::operator * ( const VecFixedN< SIZE > & rhs ) const {
+	VecFixedN< SIZE > tmp;
+	for ( int i = 0; i < SIZE; i++ ) {
+		tmp[ i ] = rows[ i ].Dot( rhs );
+	}
+	return tmp;
+}
+
+template< int SIZE >
+inline MatFixedN< SIZE > MatFixedN< SIZE >::operator * ( const MatFixedN & rhs ) const {
+	MatFixedN tmp;
+	for ( int i = 0; i < SIZE; i++ ) {
+		for ( int j = 0; j < SIZE; j++ ) {
+			float sum = 0.0f;
+			for ( int k = 0; k < SIZE; k++ ) {
+				sum += rows[ i ][ k ] * rhs.rows[ k ][ j ];
+			}
+			tmp.rows[ i ][ j ] = sum;
+		}
+	}
+	return tmp;
+}
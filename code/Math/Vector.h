@@ -5,6 +5,7 @@
 #include <math.h>
 #include <assert.h>
 #include <stdio.h>
+#include "FrameArena.h"
 
 /*
  ================================
@@ -192,10 +193,10 @@ class Vec3 {
 public:
 	Vec3();
 	Vec3( float value );
-	Vec3( const Vec3 & rhs );
+	Vec3( const Vec3 & rhs ) = default;
 	Vec3( float X, float Y, float Z );
 	Vec3( const float * xyz );
-	Vec3 & operator = ( const Vec3 & rhs );
+	Vec3 & operator = ( const Vec3 & rhs ) = default;
 	Vec3 & operator = ( const float * rhs );
     
 	bool			operator == ( const Vec3 & rhs ) const;
@@ -242,12 +243,6 @@ y( value ),
 z( value ) {
 }
 
-inline Vec3::Vec3( const Vec3 &rhs ) :
-x( rhs.x ),
-y( rhs.y ),
-z( rhs.z ) {
-}
-
 inline Vec3::Vec3( float X, float Y, float Z ) :
 x( X ),
 y( Y ),
@@ -260,13 +255,6 @@ y( xyz[ 1 ] ),
 z( xyz[ 2 ] ) {
 }
 
-inline Vec3 & Vec3::operator = ( const Vec3 & rhs ) {
-	x = rhs.x;
-	y = rhs.y;
-	z = rhs.z;
-	return *this;
-}
-
 inline Vec3& Vec3::operator=( const float * rhs ) {
 	x = rhs[ 0 ];
 	y = rhs[ 1 ];
@@ -671,11 +659,14 @@ inline bool Vec4::IsValid() const {
  */
 class VecN {
 public:
-	VecN() : N( 0 ), data( NULL ) {}
+	VecN() : N( 0 ), data( NULL ), ownsData( true ) {}
 	VecN( int _N );
+	VecN( int _N, FrameArena & arena );
 	VecN( const VecN & rhs );
+	VecN( VecN && rhs );
 	VecN & operator = ( const VecN & rhs );
-	~VecN() { delete[] data; }
+	VecN & operator = ( VecN && rhs );
+	~VecN() { Release(); }
 
 	float			operator[] ( const int idx ) const { return data[ idx ]; }
 	float &			operator[] ( const int idx ) { return data[ idx ]; }
@@ -688,36 +679,90 @@ public:
 
 	float Dot( const VecN & rhs ) const;
 	void Zero();
+
+private:
+	void Release();
 	
 public:
 	int		N;
 	float *	data;
+	bool	ownsData;	// false when data lives in a FrameArena
 };
 
 inline VecN::VecN( int _N ) {
 	N = _N;
 	data = new float[ _N ];
+	ownsData = true;
+}
+
+// The data is only valid until the next Reset of the arena
+inline VecN::VecN( int _N, FrameArena & arena ) {
+	N = _N;
+	data = arena.Allocate< float >( _N );
+	ownsData = false;
 }
 
 inline VecN::VecN( const VecN & rhs ) {
 	N = rhs.N;
 	data = new float[ N ];
+	ownsData = true;
 	for ( int i = 0; i < N; i++ ) {
 		data[ i ] = rhs.data[ i ];
 	}
 }
 
+inline VecN::VecN( VecN && rhs ) {
+	N = rhs.N;
+	data = rhs.data;
+	ownsData = rhs.ownsData;
+	rhs.N = 0;
+	rhs.data = NULL;
+	rhs.ownsData = true;
+}
+
 inline VecN & VecN::operator = ( const VecN & rhs ) {
-	delete[] data;
+	if ( this == &rhs ) {
+		return *this;
+	}
+
+	// Vectors of the same size keep their storage, arena backed or not
+	if ( N != rhs.N || data == NULL ) {
+		Release();
+		N = rhs.N;
+		data = new float[ N ];
+		ownsData = true;
+	}
 
-	N = rhs.N;
-	data = new float[ N ];
 	for ( int i = 0; i < N; i++ ) {
 		data[ i ] = rhs.data[ i ];
 	}
 	return *this;
 }
 
+inline VecN & VecN::operator = ( VecN && rhs ) {
+	if ( this == &rhs ) {
+		return *this;
+	}
+
+	Release();
+	N = rhs.N;
+	data = rhs.data;
+	ownsData = rhs.ownsData;
+	rhs.N = 0;
+	rhs.data = NULL;
+	rhs.ownsData = true;
+	return *this;
+}
+
+inline void VecN::Release() {
+	if ( ownsData ) {
+		delete[] data;
+	}
+	N = 0;
+	data = NULL;
+	ownsData = true;
+}
+
 inline const VecN & VecN::operator *= ( float rhs ) {
 	for ( int i = 0; i < N; i++ ) {
 		data[ i ] *= rhs;
@@ -773,4 +818,95 @@ inline void VecN::Zero() {
 	for ( int i = 0; i < N; i++ ) {
 		data[ i ] = 0.0f;
 	}
-}
\ No newline at end of file
+}
+
+/*
+ ================================
+ VecFixedN
+
+ VecN with its size known at compile time, for small systems.
+ The data is a member, nothing is allocated.
+ ================================
+ */
+template< int SIZE >
+class VecFixedN {
+public:
+	VecFixedN() {}
+
+	float				operator[] ( const int idx ) const { return data[ idx ]; }
+	float &				operator[] ( const int idx ) { return data[ idx ]; }
+	const VecFixedN &	operator *= ( float rhs );
+	VecFixedN			operator * ( float rhs ) const;
+	VecFixedN			operator + ( const VecFixedN & rhs ) const;
+	VecFixedN			operator - ( const VecFixedN & rhs ) const;
+	const VecFixedN &	operator += ( const VecFixedN & rhs );
+	const VecFixedN &	operator -= ( const VecFixedN & rhs );
+
+	float Dot( const VecFixedN & rhs ) const;
+	void Zero();
+
+public:
+	static const int N = SIZE;
+	float	data[ SIZE ];
+};
+
+template< int SIZE >
+inline const VecFixedN< SIZE > & VecFixedN< SIZE >::operator *= ( float rhs ) {
+	for ( int i = 0; i < SIZE; i++ ) {
+		data[ i ] *= rhs;
+	}
+	return *this;
+}
+
+template< int SIZE >
+inline VecFixedN< SIZE > VecFixedN< SIZE >::operator * ( float rhs ) const {
+	VecFixedN tmp = *this;
+	tmp *= rhs;
+	return tmp;
+}
+
+template< int SIZE >
+inline VecFixedN< SIZE > VecFixedN< SIZE >::operator + ( const VecFixedN & rhs ) const {
+	VecFixedN tmp = *this;
+	tmp += rhs;
+	return tmp;
+}
+
+template< int SIZE >
+inline VecFixedN< SIZE > VecFixedN< SIZE >::operator - ( const VecFixedN & rhs ) const {
+	VecFixedN tmp = *this;
+	tmp -= rhs;
+	return tmp;
+}
+
+template< int SIZE >
+inline const VecFixedN< SIZE > & VecFixedN< SIZE >::operator += ( const VecFixedN & rhs ) {
+	for ( int i = 0; i < SIZE; i++ ) {
+		data[ i ] += rhs.data[ i ];
+	}
+	return *this;
+}
+
+template< int SIZE >
+inline const VecFixedN< SIZE > & VecFixedN< SIZE >::operator -= ( const VecFixedN & rhs ) {
+	for ( int i = 0; i < SIZE; i++ ) {
+		data[ i ] -= rhs.data[ i ];
+	}
+	return *this;
+}
+
+template< int SIZE >
+inline float VecFixedN< SIZE >::Dot( const VecFixedN & rhs ) const {
+	float sum = 0;
+	for ( int i = 0; i < SIZE; i++ ) {
+		sum += data[ i ] * rhs.data[ i ];
+	}
+	return sum;
+}
+
+template< int SIZE >
+inline void VecFixedN< SIZE >::Zero() {
+	for ( int i = 0; i < SIZE; i++ ) {
+		data[ i ] = 0.0f;
+	}
+}
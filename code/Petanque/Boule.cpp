@@ -1,20 +1,20 @@
 #include "Boule.h"
 #include "../Physics/Shape.h"
 
-Boule::Boule()
+BodyData Boule::Create()
 {
-	position = Vec3(0, 0, 10);
-	orientation = Quat(0, 0, 0, 1);
-	shape = new ShapeSphere(1.5f);
-	inverseMass = 0.05f;
-	elasticity = 0.0f;
-	friction = 0.5f;
+	BodyData body;
+	body.position = Vec3(0, 0, 10);
+	body.orientation = Quat(0, 0, 0, 1);
+	body.shape = new ShapeSphere(1.5f);
+	body.inverseMass = 0.05f;
+	body.material.elasticity = 0.0f;
+	body.material.friction = 0.5f;
+	return body;
 }
 
-void Boule::Update(float dt_sec)
+void Boule::Settle()
 {
-	PhysicUpdate(dt_sec);
-
 	if (linearVelocity.GetLengthSqr() < 2.0f)
 	{
 		linearVelocity.Zero();
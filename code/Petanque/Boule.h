@@ -1,11 +1,15 @@
 #pragma once
 #include "../Physics/Body.h"
 
+// View over the body of a boule in the scene
 class Boule : public Body
 {
 public:
-	Boule();
+	Boule(Body body) : Body(body) {}
 
-	void Update(float dt_sec) override;
-};
+	// Body of a new boule, to add to the scene
+	static BodyData Create();
 
+	// Boules rolling too slowly stop at once, called after every physics update
+	void Settle();
+};
@@ -1,20 +1,20 @@
 #include "Cochonnet.h"
 #include "../Physics/Shape.h"
 
-Cochonnet::Cochonnet()
+BodyData Cochonnet::Create()
 {
-	position = Vec3(0, 0, 10);
-	orientation = Quat(0, 0, 0, 1);
-	shape = new ShapeSphere(0.5);
-	inverseMass = 1.0f;
-	elasticity = 0.4f;
-	friction = 0.5f;
+	BodyData body;
+	body.position = Vec3(0, 0, 10);
+	body.orientation = Quat(0, 0, 0, 1);
+	body.shape = new ShapeSphere(0.5);
+	body.inverseMass = 1.0f;
+	body.material.elasticity = 0.4f;
+	body.material.friction = 0.5f;
+	return body;
 }
 
-void Cochonnet::Update(float dt_sec)
+void Cochonnet::Settle()
 {
-	PhysicUpdate(dt_sec);
-
 	if (linearVelocity.GetLengthSqr() < 2.0f)
 	{
 		linearVelocity.Zero();
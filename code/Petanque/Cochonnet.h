@@ -1,11 +1,15 @@
 #pragma once
 #include "../Physics/Body.h"
 
+// View over the body of the cochonnet in the scene
 class Cochonnet : public Body
 {
 public:
-	Cochonnet();
+	Cochonnet(Body body) : Body(body) {}
 
-	void Update(float dt_sec) override;
-};
+	// Body of a new cochonnet, to add to the scene
+	static BodyData Create();
 
+	// The cochonnet stops at once when it rolls too slowly, called after every physics update
+	void Settle();
+};
@@ -1,19 +1,34 @@
 #include "Body.h"
 #include "Shape.h"
 
-Vec3 Body::GetCenterOfMassWorldSpace() const
+ConstBody::ConstBody(const BodyData& data) :
+	position(data.position),
+	orientation(data.orientation),
+	linearVelocity(data.linearVelocity),
+	angularVelocity(data.angularVelocity),
+	inverseMass(data.inverseMass),
+	elasticity(data.material.elasticity),
+	friction(data.material.friction),
+	shape(data.shape),
+	isSleeping(data.sleep.isSleeping),
+	sleepTimer(data.sleep.sleepTimer),
+	inertia(data.inertia)
+{
+}
+
+Vec3 ConstBody::GetCenterOfMassWorldSpace() const
 {
 	const Vec3 center_of_mass = shape->GetCenterOfMass();
 	const Vec3 pos = position + orientation.RotatePoint(center_of_mass);
 	return pos;
 }
 
-Vec3 Body::GetCenterOfMassBodySpace() const
+Vec3 ConstBody::GetCenterOfMassBodySpace() const
 {
 	return shape->GetCenterOfMass(); 
 }
 
-Vec3 Body::WorldSpaceToBodySpace(const Vec3& worldPoint)
+Vec3 ConstBody::WorldSpaceToBodySpace(const Vec3& worldPoint) const
 {
 	const Vec3 temp = worldPoint - GetCenterOfMassWorldSpace();
 	const Quat invert_orient = orientation.Inverse();
@@ -21,42 +36,138 @@ Vec3 Body::WorldSpaceToBodySpace(const Vec3& worldPoint)
 	return body_space; 
 }
 
-Vec3 Body::BodySpaceToWorldSpace(const Vec3& bodyPoint)
+Vec3 ConstBody::BodySpaceToWorldSpace(const Vec3& bodyPoint) const
 {
 	Vec3 world_space = GetCenterOfMassWorldSpace() + orientation.RotatePoint(bodyPoint);
 	return world_space; 
 }
 
-Mat3 Body::GetInverseInertiaTensorBodySpace() const
+Mat3 ConstBody::GetInverseInertiaTensorBodySpace() const
+{
+	return inertia.inverseBodySpace * inverseMass;
+}
+
+Mat3 ConstBody::GetInverseInertiaTensorWorldSpace() const
+{
+	return inertia.inverseWorldSpace * inverseMass; 
+}
+
+Vec3 ConstBody::ApplyInverseInertiaWorldSpace(const Vec3& vector) const
+{
+	if (inverseMass == 0.0f) return Vec3(0.0f);
+
+	if (inertia.isotropic)
+	{
+		return vector * (inertia.inverseScalar * inverseMass);
+	}
+	return inertia.inverseWorldSpace * vector * inverseMass;
+}
+
+BodyData ConstBody::GetData() const
 {
-	Mat3 inertia_tensor = shape->InertiaTensor(); 
-	Mat3 inverse_inertia_tensor = inertia_tensor.Inverse() * inverseMass;
-	return inverse_inertia_tensor;
+	BodyData data;
+	data.position = position;
+	data.orientation = orientation;
+	data.linearVelocity = linearVelocity;
+	data.angularVelocity = angularVelocity;
+	data.inverseMass = inverseMass;
+	data.material.elasticity = elasticity;
+	data.material.friction = friction;
+	data.shape = shape;
+	data.sleep.isSleeping = isSleeping;
+	data.sleep.sleepTimer = sleepTimer;
+	data.inertia = inertia;
+	return data;
 }
 
-Mat3 Body::GetInverseInertiaTensorWorldSpace() const
+BodyData ConstBody::Predict(const float dt_sec) const
 {
-	Mat3 inertia_tensor = shape->InertiaTensor(); 
-	Mat3 inverse_inertia_tensor = inertia_tensor.Inverse() * inverseMass; 
-	Mat3 orient = orientation.ToMat3(); 
-	inverse_inertia_tensor = orient * inverse_inertia_tensor * orient.Transpose(); 
-	return inverse_inertia_tensor; 
+	BodyData predicted = GetData();
+	Body(predicted).Update(dt_sec);
+	return predicted;
+}
+
+float ConstBody::GetMotionEnergy() const
+{
+	return 0.5f * (linearVelocity.GetLengthSqr() + angularVelocity.GetLengthSqr());
+}
+
+
+
+Body::Body(BodyData& data) :
+	position(data.position),
+	orientation(data.orientation),
+	linearVelocity(data.linearVelocity),
+	angularVelocity(data.angularVelocity),
+	inverseMass(data.inverseMass),
+	elasticity(data.material.elasticity),
+	friction(data.material.friction),
+	shape(data.shape),
+	isSleeping(data.sleep.isSleeping),
+	sleepTimer(data.sleep.sleepTimer),
+	inertia(data.inertia)
+{
+}
+
+void Body::UpdateInertia()
+{
+	if (inertia.shape != shape || inertia.shapeRevision != shape->GetRevision())
+	{
+		inertia.shape = shape;
+		inertia.shapeRevision = shape->GetRevision();
+		inertia.worldValid = false;
+
+		inertia.isotropic = shape->GetType() == Shape::ShapeType::SHAPE_SPHERE;
+		if (inertia.isotropic)
+		{
+			// Solid sphere: I = 2/5 * r^2 around every axis
+			const float radius = static_cast<const ShapeSphere*>(shape)->radius;
+			inertia.inverseScalar = 5.0f / (2.0f * radius * radius);
+
+			inertia.bodySpace.Identity();
+			inertia.bodySpace *= 1.0f / inertia.inverseScalar;
+			inertia.inverseBodySpace.Identity();
+			inertia.inverseBodySpace *= inertia.inverseScalar;
+			inertia.worldSpace = inertia.bodySpace;
+			inertia.inverseWorldSpace = inertia.inverseBodySpace;
+		}
+		else
+		{
+			inertia.bodySpace = shape->InertiaTensor();
+			inertia.inverseBodySpace = inertia.bodySpace.Inverse();
+		}
+	}
+
+	// Rotating the tensors is only needed when the orientation changed since the last time
+	if (inertia.isotropic) return;
+	if (inertia.worldValid && orientation.x == inertia.orientation.x && orientation.y == inertia.orientation.y
+		&& orientation.z == inertia.orientation.z && orientation.w == inertia.orientation.w) return;
+
+	const Mat3 orient = orientation.ToMat3();
+	const Mat3 orient_transpose = orient.Transpose();
+	inertia.worldSpace = orient * inertia.bodySpace * orient_transpose;
+	inertia.inverseWorldSpace = orient * inertia.inverseBodySpace * orient_transpose;
+	inertia.orientation = orientation;
+	inertia.worldValid = true;
 }
 
 
 
-void Body::PhysicUpdate(const float dt_sec)
+void Body::Update(const float dt_sec)
 {
+	if (isSleeping) return;
+
 	position += linearVelocity * dt_sec;
 
 	Vec3 position_cm = GetCenterOfMassWorldSpace();  
 	Vec3 cm_to_position = position - position_cm; 
 	 
-	Mat3 orientation_mat = orientation.ToMat3(); 
-	Mat3 inertia_tensor = orientation_mat * shape->InertiaTensor() * orientation_mat.Transpose(); 
-	Vec3 alpha = inertia_tensor.Inverse() * (angularVelocity.Cross(inertia_tensor * angularVelocity));
-
-	angularVelocity += alpha * dt_sec;
+	// Gyroscopic effect, there is none when the inertia is the same around every axis
+	if (!inertia.isotropic)
+	{
+		Vec3 alpha = inertia.inverseWorldSpace * (angularVelocity.Cross(inertia.worldSpace * angularVelocity));
+		angularVelocity += alpha * dt_sec;
+	}
 
 	// Update orientation
 	Vec3 dangle = angularVelocity * dt_sec;  
@@ -66,11 +177,21 @@ void Body::PhysicUpdate(const float dt_sec)
 
 	// Get the new model position
 	position = position_cm + dq.RotatePoint(cm_to_position); 
+
+	UpdateInertia();
 }
 
-void Body::Update(const float dt_sec)
+void Body::Wake()
 {
-	PhysicUpdate(dt_sec);
+	isSleeping = false;
+	sleepTimer = 0.0f;
+}
+
+void Body::Sleep()
+{
+	isSleeping = true;
+	linearVelocity.Zero();
+	angularVelocity.Zero();
 }
 
 
@@ -78,6 +199,7 @@ void Body::Update(const float dt_sec)
 void Body::ApplyImpulseLinear(const Vec3& impulse)
 {
 	if (inverseMass == 0.0f) return;
+	if (isSleeping) Wake();
 
 	linearVelocity += impulse * inverseMass;
 }
@@ -85,14 +207,48 @@ void Body::ApplyImpulseLinear(const Vec3& impulse)
 void Body::ApplyImpulseAngular(const Vec3& impulse)
 {
 	if (inverseMass == 0.0f) return;
+	if (isSleeping) Wake();
 
-	angularVelocity += GetInverseInertiaTensorWorldSpace() * impulse;
+	angularVelocity += ApplyInverseInertiaWorldSpace(impulse);
+	ClampAngularVelocity();
+}
 
-	const float max_angular_speed = 30.0f;
-	if (angularVelocity.GetLengthSqr() > max_angular_speed * max_angular_speed)
+void Body::SetVelocities(const Vec3& linear, const Vec3& angular)
+{
+	if (inverseMass == 0.0f) return;
+	if (linear == linearVelocity && angular == angularVelocity) return;
+	if (isSleeping) Wake();
+
+	linearVelocity = linear;
+	angularVelocity = angular;
+	ClampAngularVelocity();
+}
+
+void Body::Displace(const Vec3& translation, const Vec3& rotation)
+{
+	if (inverseMass == 0.0f) return;
+
+	position += translation;
+
+	const float angle = rotation.GetMagnitude();
+	if (angle == 0.0f) return;
+
+	const Vec3 position_cm = GetCenterOfMassWorldSpace();
+	const Vec3 cm_to_position = position - position_cm;
+	const Quat dq = Quat(rotation, angle);
+	orientation = dq * orientation;
+	orientation.Normalize();
+	position = position_cm + dq.RotatePoint(cm_to_position);
+
+	UpdateInertia();
+}
+
+void Body::ClampAngularVelocity()
+{
+	if (angularVelocity.GetLengthSqr() > maxAngularSpeed * maxAngularSpeed)
 	{
 		angularVelocity.Normalize();
-		angularVelocity *= max_angular_speed;
+		angularVelocity *= maxAngularSpeed;
 	}
 }
 
@@ -3,30 +3,159 @@
 #include "../Renderer/model.h"
 #include "../Math/Quat.h"
 
-class Body
+class BodyStore;
+class Body;
+
+// Inertia tensors of a body for a mass of one, the inverse mass is only applied when they are used.
+// They follow the shape and the orientation of the body, see Body::UpdateInertia.
+struct BodyInertia
+{
+	const Shape* shape{ nullptr };
+	// Shape::GetRevision when the shape tensors were read
+	unsigned int shapeRevision{ 0 };
+	Quat orientation;
+	bool worldValid{ false };
+	// Spheres have the same inertia around every axis, it is a single scalar which doesn't depend on the orientation
+	bool isotropic{ false };
+	float inverseScalar{ 0.0f };
+	Mat3 bodySpace;
+	Mat3 inverseBodySpace;
+	Mat3 worldSpace;
+	Mat3 inverseWorldSpace;
+};
+
+// Bounce and friction of a body, combined with the ones of the other body of a contact
+struct BodyMaterial
+{
+	float elasticity{ 0.0f };
+	float friction{ 0.0f };
+};
+
+// See Body::isSleeping and Body::sleepTimer
+struct BodySleep
+{
+	bool isSleeping{ false };
+	float sleepTimer{ 0.0f };
+};
+
+/// <summary>
+/// Every field of a body in one place.
+/// It describes the bodies added to a BodyStore, and holds the copies of bodies moved without touching the scene.
+/// </summary>
+struct BodyData
 {
-public:
 	Vec3 position;
 	Quat orientation;
 	Vec3 linearVelocity;
 	Vec3 angularVelocity;
-	float inverseMass;
-	float elasticity;
-	float friction;
-	Shape* shape;
+	float inverseMass{ 0.0f };
+	BodyMaterial material;
+	Shape* shape{ nullptr };
+	BodySleep sleep;
+	BodyInertia inertia;
+};
+
+/// <summary>
+/// Read-only view over the fields of one body, see Body.
+/// It is what a const BodyStore gives, and what the queries which never move a body take.
+/// </summary>
+class ConstBody
+{
+public:
+	ConstBody(const BodyData& data);
+	ConstBody(const Body& body);
+
+	const Vec3& position;
+	const Quat& orientation;
+	const Vec3& linearVelocity;
+	const Vec3& angularVelocity;
+	const float& inverseMass;
+	const float& elasticity;
+	const float& friction;
+	Shape* const& shape;
+	const bool& isSleeping;
+	const float& sleepTimer;
 
 	Vec3 GetCenterOfMassWorldSpace() const;
 	Vec3 GetCenterOfMassBodySpace() const;
 
-	Vec3 WorldSpaceToBodySpace(const Vec3& worldPoint);
-	Vec3 BodySpaceToWorldSpace(const Vec3& bodyPoint);
+	Vec3 WorldSpaceToBodySpace(const Vec3& worldPoint) const;
+	Vec3 BodySpaceToWorldSpace(const Vec3& bodyPoint) const;
 
 	Mat3 GetInverseInertiaTensorBodySpace() const;
 	Mat3 GetInverseInertiaTensorWorldSpace() const;
+	// Inverse inertia tensor in world space times a world space vector, without building the tensor for spheres
+	Vec3 ApplyInverseInertiaWorldSpace(const Vec3& vector) const;
+
+	// Copy of the body
+	BodyData GetData() const;
+	// Copy of the body moved by dt_sec of free motion, this body is left untouched
+	BodyData Predict(const float dt_sec) const;
+
+	// Kinetic energy for a mass of one, the angular part taken as if the whole mass was at a distance of one
+	float GetMotionEnergy() const;
+
+private:
+	friend class BodyStore;
+	ConstBody(const BodyStore& store, const int index);
+
+	const BodyInertia& inertia;
+};
+
+/// <summary>
+/// View over the fields of one body, wherever they are stored: in the arrays of a BodyStore or in a BodyData.
+/// Its fields are references, so the body reads and is written like a plain object, but copying a view
+/// doesn't copy the body. GetData or Predict give copies.
+/// </summary>
+class Body
+{
+public:
+	Body(BodyData& data);
+	// Copies only come from writable views, a const view never gives a writable one (see ConstBody)
+	Body(Body& body) = default;
+	Body(Body&& body) = default;
+
+	Vec3& position;
+	Quat& orientation;
+	Vec3& linearVelocity;
+	Vec3& angularVelocity;
+	float& inverseMass;
+	float& elasticity;
+	float& friction;
+	Shape*& shape;
+
+	// Sleeping bodies are not moved nor tested against each other, until a contact or an impulse wakes them
+	bool& isSleeping;
+	// Time the body has been slow enough to fall asleep for
+	float& sleepTimer;
+
+	// Queries of ConstBody
+	Vec3 GetCenterOfMassWorldSpace() const { return ConstBody(*this).GetCenterOfMassWorldSpace(); }
+	Vec3 GetCenterOfMassBodySpace() const { return ConstBody(*this).GetCenterOfMassBodySpace(); }
+
+	Vec3 WorldSpaceToBodySpace(const Vec3& worldPoint) const { return ConstBody(*this).WorldSpaceToBodySpace(worldPoint); }
+	Vec3 BodySpaceToWorldSpace(const Vec3& bodyPoint) const { return ConstBody(*this).BodySpaceToWorldSpace(bodyPoint); }
+
+	Mat3 GetInverseInertiaTensorBodySpace() const { return ConstBody(*this).GetInverseInertiaTensorBodySpace(); }
+	Mat3 GetInverseInertiaTensorWorldSpace() const { return ConstBody(*this).GetInverseInertiaTensorWorldSpace(); }
+	Vec3 ApplyInverseInertiaWorldSpace(const Vec3& vector) const { return ConstBody(*this).ApplyInverseInertiaWorldSpace(vector); }
+
+	BodyData GetData() const { return ConstBody(*this).GetData(); }
+	BodyData Predict(const float dt_sec) const { return ConstBody(*this).Predict(dt_sec); }
 
+	float GetMotionEnergy() const { return ConstBody(*this).GetMotionEnergy(); }
 
-	void PhysicUpdate(const float dt_sec);
-	virtual void Update(const float dt_sec);
+
+	void Update(const float dt_sec);
+
+	// Reads the shape tensors again if the shape was replaced or changed, and rotates them again if the orientation changed.
+	// The queries only read the tensors: the store refreshes every body at the start of a step and when it adds one,
+	// Update and Displace after they turn the body. Call it after setting the shape or the orientation of a BodyData.
+	void UpdateInertia();
+
+	void Wake();
+	// Stops the body, it stays still until it is woken
+	void Sleep();
 
 
 	void ApplyImpulseLinear(const Vec3& impulse);
@@ -42,5 +171,38 @@ public:
 	/// The world space direction and magnitude of the impulse
 	///</param>
 	void ApplyImpulse(const Vec3& impulsePoint, const Vec3& impulse);
+
+	// Sets the velocities a solver found, waking the body if they changed, with the same limit as the impulses
+	void SetVelocities(const Vec3& linear, const Vec3& angular);
+
+	// Moves the body and turns it around its center of mass, without changing its velocities
+	void Displace(const Vec3& translation, const Vec3& rotation);
+
+	// Impulses never make a body spin faster than this
+	static constexpr float maxAngularSpeed = 30.0f;
+
+private:
+	friend class BodyStore;
+	friend class ConstBody;
+	Body(BodyStore& store, const int index);
+
+	void ClampAngularVelocity();
+
+	BodyInertia& inertia;
 };
 
+
+inline ConstBody::ConstBody(const Body& body) :
+	position(body.position),
+	orientation(body.orientation),
+	linearVelocity(body.linearVelocity),
+	angularVelocity(body.angularVelocity),
+	inverseMass(body.inverseMass),
+	elasticity(body.elasticity),
+	friction(body.friction),
+	shape(body.shape),
+	isSleeping(body.isSleeping),
+	sleepTimer(body.sleepTimer),
+	inertia(body.inertia)
+{
+}
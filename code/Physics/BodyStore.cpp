@@ -0,0 +1,139 @@
+#include "BodyStore.h"
+
+
+BodyHandle BodyStore::Create(const BodyData& data)
+{
+	int slot = firstFreeSlot;
+	if (slot >= 0)
+	{
+		firstFreeSlot = slots[slot].index;
+	}
+	else
+	{
+		slot = (int)slots.size();
+		slots.push_back(Slot{ 0, 0 });
+	}
+	slots[slot].index = size();
+	bodySlots.push_back(slot);
+
+	positions.push_back(data.position);
+	orientations.push_back(data.orientation);
+	linearVelocities.push_back(data.linearVelocity);
+	angularVelocities.push_back(data.angularVelocity);
+	inverseMasses.push_back(data.inverseMass);
+	materials.push_back(data.material);
+	shapes.push_back(data.shape);
+	sleeps.push_back(data.sleep);
+	inertias.push_back(data.inertia);
+	(*this)[size() - 1].UpdateInertia();
+	version++;
+
+	return BodyHandle{ slot, slots[slot].generation };
+}
+
+void BodyStore::Destroy(const BodyHandle handle)
+{
+	if (!IsValid(handle)) return;
+
+	// The last body fills the hole, so the arrays stay packed
+	const int index = slots[handle.slot].index;
+	const int last = size() - 1;
+	if (index != last)
+	{
+		positions[index] = positions[last];
+		orientations[index] = orientations[last];
+		linearVelocities[index] = linearVelocities[last];
+		angularVelocities[index] = angularVelocities[last];
+		inverseMasses[index] = inverseMasses[last];
+		materials[index] = materials[last];
+		shapes[index] = shapes[last];
+		sleeps[index] = sleeps[last];
+		inertias[index] = inertias[last];
+
+		bodySlots[index] = bodySlots[last];
+		slots[bodySlots[index]].index = index;
+	}
+
+	positions.pop_back();
+	orientations.pop_back();
+	linearVelocities.pop_back();
+	angularVelocities.pop_back();
+	inverseMasses.pop_back();
+	materials.pop_back();
+	shapes.pop_back();
+	sleeps.pop_back();
+	inertias.pop_back();
+	bodySlots.pop_back();
+
+	slots[handle.slot].generation++;
+	slots[handle.slot].index = firstFreeSlot;
+	firstFreeSlot = handle.slot;
+
+	version++;
+	removalVersion++;
+}
+
+void BodyStore::Clear()
+{
+	for (const int slot : bodySlots)
+	{
+		slots[slot].generation++;
+		slots[slot].index = firstFreeSlot;
+		firstFreeSlot = slot;
+	}
+	bodySlots.clear();
+
+	positions.clear();
+	orientations.clear();
+	linearVelocities.clear();
+	angularVelocities.clear();
+	inverseMasses.clear();
+	materials.clear();
+	shapes.clear();
+	sleeps.clear();
+	inertias.clear();
+
+	version++;
+	removalVersion++;
+}
+
+void BodyStore::Reserve(const int count)
+{
+	positions.reserve(count);
+	orientations.reserve(count);
+	linearVelocities.reserve(count);
+	angularVelocities.reserve(count);
+	inverseMasses.reserve(count);
+	materials.reserve(count);
+	shapes.reserve(count);
+	sleeps.reserve(count);
+	inertias.reserve(count);
+	bodySlots.reserve(count);
+}
+
+void BodyStore::UpdateInertias()
+{
+	for (int i = 0; i < size(); i++)
+	{
+		(*this)[i].UpdateInertia();
+	}
+}
+
+bool BodyStore::IsValid(const BodyHandle handle) const
+{
+	if (handle.slot < 0 || handle.slot >= (int)slots.size()) return false;
+
+	// Free slots always have a newer generation than the handles given for them
+	return slots[handle.slot].generation == handle.generation;
+}
+
+int BodyStore::GetIndex(const BodyHandle handle) const
+{
+	return IsValid(handle) ? slots[handle.slot].index : -1;
+}
+
+BodyHandle BodyStore::GetHandle(const int index) const
+{
+	const int slot = bodySlots[index];
+	return BodyHandle{ slot, slots[slot].generation };
+}
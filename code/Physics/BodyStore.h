@@ -0,0 +1,136 @@
+#pragma once
+#include <vector>
+#include "Body.h"
+
+
+// Handle of a body in a BodyStore.
+// The generation tells the handles of a destroyed body from the ones of the body reusing its slot.
+struct BodyHandle
+{
+	int slot{ -1 };
+	unsigned int generation{ 0 };
+};
+
+
+/// <summary>
+/// Bodies of a scene, stored field by field in parallel arrays, so the loops over one field of every body
+/// (gravity, bounds, solver gathers) read contiguous memory instead of chasing a pointer per body.
+/// Bodies are packed at the front of the arrays and the systems address them by their index. An index only
+/// holds until a body is destroyed: the last body then takes the place of the destroyed one.
+/// Game code keeps handles instead, which stay valid until their own body is destroyed.
+/// </summary>
+class BodyStore
+{
+public:
+	// Adds a body at the end of the arrays, its index is the previous size
+	BodyHandle Create(const BodyData& data);
+	// Removes the body, the last one takes its index. Systems keyed by index must check GetRemovalVersion or be cleared.
+	void Destroy(const BodyHandle handle);
+	// Removes every body, their handles all become invalid
+	void Clear();
+	void Reserve(const int count);
+
+	bool IsValid(const BodyHandle handle) const;
+	// Index of the body of the handle, -1 if it was destroyed
+	int GetIndex(const BodyHandle handle) const;
+	BodyHandle GetHandle(const int index) const;
+
+	// Body of a handle, which must be valid
+	Body Get(const BodyHandle handle) { return (*this)[GetIndex(handle)]; }
+
+	Body operator[](const int index) { return Body(*this, index); }
+	ConstBody operator[](const int index) const { return ConstBody(*this, index); }
+
+	// Brings the inertia tensors of every body up to date with its shape and its orientation, see Body::UpdateInertia
+	void UpdateInertias();
+
+	int size() const { return (int)positions.size(); }
+	bool empty() const { return positions.empty(); }
+
+	// Increased by every Create, Destroy and Clear: systems keeping data per index compare it to know the bodies changed
+	unsigned int GetVersion() const { return version; }
+	// Increased by Destroy and Clear only, after which bodies may have moved to another index
+	unsigned int GetRemovalVersion() const { return removalVersion; }
+
+	// One entry per body, read and written in place but only resized by the store
+	std::vector<Vec3> positions;
+	std::vector<Quat> orientations;
+	std::vector<Vec3> linearVelocities;
+	std::vector<Vec3> angularVelocities;
+	std::vector<float> inverseMasses;
+	std::vector<BodyMaterial> materials;
+	std::vector<Shape*> shapes;
+	std::vector<BodySleep> sleeps;
+	std::vector<BodyInertia> inertias;
+
+private:
+	// Index of the body of a used slot, or the next free slot of a free one
+	struct Slot
+	{
+		int index;
+		unsigned int generation;
+	};
+
+	std::vector<Slot> slots;
+	// Slot of every body
+	std::vector<int> bodySlots;
+	int firstFreeSlot{ -1 };
+
+	unsigned int version{ 0 };
+	unsigned int removalVersion{ 0 };
+};
+
+
+inline Body::Body(BodyStore& store, const int index) :
+	position(store.positions[index]),
+	orientation(store.orientations[index]),
+	linearVelocity(store.linearVelocities[index]),
+	angularVelocity(store.angularVelocities[index]),
+	inverseMass(store.inverseMasses[index]),
+	elasticity(store.materials[index].elasticity),
+	friction(store.materials[index].friction),
+	shape(store.shapes[index]),
+	isSleeping(store.sleeps[index].isSleeping),
+	sleepTimer(store.sleeps[index].sleepTimer),
+	inertia(store.inertias[index])
+{
+}
+
+inline ConstBody::ConstBody(const BodyStore& store, const int index) :
+	position(store.positions[index]),
+	orientation(store.orientations[index]),
+	linearVelocity(store.linearVelocities[index]),
+	angularVelocity(store.angularVelocities[index]),
+	inverseMass(store.inverseMasses[index]),
+	elasticity(store.materials[index].elasticity),
+	friction(store.materials[index].friction),
+	shape(store.shapes[index]),
+	isSleeping(store.sleeps[index].isSleeping),
+	sleepTimer(store.sleeps[index].sleepTimer),
+	inertia(store.inertias[index])
+{
+}
+
+
+/// <summary>
+/// Non-owning view over some bodies of a store, picked by their index.
+/// Reading the bodies through it doesn't copy anything.
+/// </summary>
+class BodyView
+{
+public:
+	BodyView() {}
+	BodyView(const BodyStore& storeP, const std::vector<int>& ids) : store(&storeP), data(ids.data()), count(ids.size()) {}
+
+	ConstBody operator[](const size_t index) const { return (*store)[data[index]]; }
+	size_t size() const { return count; }
+
+	// Index in the store of a body of the view
+	int GetIndex(const size_t index) const { return data[index]; }
+	const BodyStore& GetStore() const { return *store; }
+
+private:
+	const BodyStore* store{ nullptr };
+	const int* data{ nullptr };
+	size_t count{ 0 };
+};
@@ -0,0 +1,249 @@
+#include "BoundsBatch.h"
+#include "Broadphase.h"
+#include "Shape.h"
+#include <algorithm>
+#include <math.h>
+#include <xmmintrin.h>
+
+
+void BoundsBatch::ComputeSweptBounds(const BodyView& bodies, const float dt_sec, std::vector<Bounds>& outBounds)
+{
+	const int num = (int)bodies.size();
+	if (num != numBodies)
+	{
+		SetShapes(bodies);
+	}
+
+	Gather(bodies);
+
+	const int num_simd = num & ~3;
+	ComputeLanesSSE(0, num_simd, dt_sec);
+	ComputeLanes(num_simd, num, dt_sec);
+
+	const float* min_x = GetStream(MIN_X);
+	const float* min_y = GetStream(MIN_Y);
+	const float* min_z = GetStream(MIN_Z);
+	const float* max_x = GetStream(MAX_X);
+	const float* max_y = GetStream(MAX_Y);
+	const float* max_z = GetStream(MAX_Z);
+
+	outBounds.resize(num);
+	for (int i = 0; i < num; i++)
+	{
+		Bounds& bounds = outBounds[i];
+		bounds.mins = Vec3(min_x[i], min_y[i], min_z[i]);
+		bounds.maxs = Vec3(max_x[i], max_y[i], max_z[i]);
+	}
+}
+
+void BoundsBatch::Clear()
+{
+	streams.clear();
+	ignoresRotation.clear();
+	gatheredAsleep.clear();
+	stride = 0;
+	numBodies = 0;
+}
+
+void BoundsBatch::SetShapes(const BodyView& bodies)
+{
+	numBodies = (int)bodies.size();
+	stride = (numBodies + 3) & ~3;
+	streams.assign(stride * NUM_STREAMS, 0.0f);
+	ignoresRotation.resize(numBodies);
+	gatheredAsleep.assign(numBodies, false);
+
+	float* center_x = GetStream(CENTER_X);
+	float* center_y = GetStream(CENTER_Y);
+	float* center_z = GetStream(CENTER_Z);
+	float* extent_x = GetStream(EXTENT_X);
+	float* extent_y = GetStream(EXTENT_Y);
+	float* extent_z = GetStream(EXTENT_Z);
+
+	// Shapes never change, their local box is only read once instead of through a virtual call each step
+	const BodyStore& store = bodies.GetStore();
+	for (int i = 0; i < numBodies; i++)
+	{
+		const Shape* shape = store.shapes[bodies.GetIndex(i)];
+		const Bounds local_bounds = shape->GetBounds();
+		const Vec3 center = (local_bounds.mins + local_bounds.maxs) * 0.5f;
+		const Vec3 extent = (local_bounds.maxs - local_bounds.mins) * 0.5f;
+
+		center_x[i] = center.x;
+		center_y[i] = center.y;
+		center_z[i] = center.z;
+		extent_x[i] = extent.x;
+		extent_y[i] = extent.y;
+		extent_z[i] = extent.z;
+
+		ignoresRotation[i] = shape->GetType() == Shape::ShapeType::SHAPE_SPHERE;
+	}
+}
+
+void BoundsBatch::Gather(const BodyView& bodies)
+{
+	float* position_x = GetStream(POSITION_X);
+	float* position_y = GetStream(POSITION_Y);
+	float* position_z = GetStream(POSITION_Z);
+	float* orientation_x = GetStream(ORIENTATION_X);
+	float* orientation_y = GetStream(ORIENTATION_Y);
+	float* orientation_z = GetStream(ORIENTATION_Z);
+	float* orientation_w = GetStream(ORIENTATION_W);
+	float* velocity_x = GetStream(VELOCITY_X);
+	float* velocity_y = GetStream(VELOCITY_Y);
+	float* velocity_z = GetStream(VELOCITY_Z);
+
+	const BodyStore& store = bodies.GetStore();
+	for (int i = 0; i < numBodies; i++)
+	{
+		const int id = bodies.GetIndex(i);
+
+		// A sleeping body doesn't move, what was read once it fell asleep is still right
+		const bool is_sleeping = store.sleeps[id].isSleeping;
+		if (is_sleeping && gatheredAsleep[i]) continue;
+		gatheredAsleep[i] = is_sleeping;
+
+		const Vec3& position = store.positions[id];
+		position_x[i] = position.x;
+		position_y[i] = position.y;
+		position_z[i] = position.z;
+
+		// A rotated sphere keeps the same bounds, the rotation would only inflate them
+		const Quat orientation = ignoresRotation[i] ? Quat() : store.orientations[id];
+		orientation_x[i] = orientation.x;
+		orientation_y[i] = orientation.y;
+		orientation_z[i] = orientation.z;
+		orientation_w[i] = orientation.w;
+
+		const Vec3& velocity = store.linearVelocities[id];
+		velocity_x[i] = velocity.x;
+		velocity_y[i] = velocity.y;
+		velocity_z[i] = velocity.z;
+	}
+}
+
+void BoundsBatch::ComputeLanes(const int begin, const int end, const float dt_sec)
+{
+	const float* position[3] = { GetStream(POSITION_X), GetStream(POSITION_Y), GetStream(POSITION_Z) };
+	const float* velocity[3] = { GetStream(VELOCITY_X), GetStream(VELOCITY_Y), GetStream(VELOCITY_Z) };
+	const float* center[3] = { GetStream(CENTER_X), GetStream(CENTER_Y), GetStream(CENTER_Z) };
+	const float* extent[3] = { GetStream(EXTENT_X), GetStream(EXTENT_Y), GetStream(EXTENT_Z) };
+	float* mins[3] = { GetStream(MIN_X), GetStream(MIN_Y), GetStream(MIN_Z) };
+	float* maxs[3] = { GetStream(MAX_X), GetStream(MAX_Y), GetStream(MAX_Z) };
+
+	const float* orientation_x = GetStream(ORIENTATION_X);
+	const float* orientation_y = GetStream(ORIENTATION_Y);
+	const float* orientation_z = GetStream(ORIENTATION_Z);
+	const float* orientation_w = GetStream(ORIENTATION_W);
+
+	for (int i = begin; i < end; i++)
+	{
+		const float x = orientation_x[i];
+		const float y = orientation_y[i];
+		const float z = orientation_z[i];
+		const float w = orientation_w[i];
+
+		// Rotation matrix of the unit quaternion
+		const float rotation[3][3] =
+		{
+			{ 1.0f - 2.0f * (y * y + z * z), 2.0f * (x * y - w * z), 2.0f * (x * z + w * y) },
+			{ 2.0f * (x * y + w * z), 1.0f - 2.0f * (x * x + z * z), 2.0f * (y * z - w * x) },
+			{ 2.0f * (x * z - w * y), 2.0f * (y * z + w * x), 1.0f - 2.0f * (x * x + y * y) }
+		};
+
+		for (int k = 0; k < 3; k++)
+		{
+			float world_center = position[k][i];
+			float world_extent = 0.0f;
+			for (int j = 0; j < 3; j++)
+			{
+				world_center += rotation[k][j] * center[j][i];
+				world_extent += fabsf(rotation[k][j]) * extent[j][i];
+			}
+
+			const float motion = velocity[k][i] * dt_sec;
+			mins[k][i] = world_center - world_extent + std::min(motion, 0.0f) - sweptBoundsMargin;
+			maxs[k][i] = world_center + world_extent + std::max(motion, 0.0f) + sweptBoundsMargin;
+		}
+	}
+}
+
+void BoundsBatch::ComputeLanesSSE(const int begin, const int end, const float dt_sec)
+{
+	const float* position[3] = { GetStream(POSITION_X), GetStream(POSITION_Y), GetStream(POSITION_Z) };
+	const float* velocity[3] = { GetStream(VELOCITY_X), GetStream(VELOCITY_Y), GetStream(VELOCITY_Z) };
+	const float* center[3] = { GetStream(CENTER_X), GetStream(CENTER_Y), GetStream(CENTER_Z) };
+	const float* extent[3] = { GetStream(EXTENT_X), GetStream(EXTENT_Y), GetStream(EXTENT_Z) };
+	float* mins[3] = { GetStream(MIN_X), GetStream(MIN_Y), GetStream(MIN_Z) };
+	float* maxs[3] = { GetStream(MAX_X), GetStream(MAX_Y), GetStream(MAX_Z) };
+
+	const float* orientation_x = GetStream(ORIENTATION_X);
+	const float* orientation_y = GetStream(ORIENTATION_Y);
+	const float* orientation_z = GetStream(ORIENTATION_Z);
+	const float* orientation_w = GetStream(ORIENTATION_W);
+
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 two = _mm_set1_ps(2.0f);
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 sign_mask = _mm_set1_ps(-0.0f);
+	const __m128 margin = _mm_set1_ps(sweptBoundsMargin);
+	const __m128 dt = _mm_set1_ps(dt_sec);
+
+	for (int i = begin; i < end; i += 4)
+	{
+		const __m128 x = _mm_loadu_ps(orientation_x + i);
+		const __m128 y = _mm_loadu_ps(orientation_y + i);
+		const __m128 z = _mm_loadu_ps(orientation_z + i);
+		const __m128 w = _mm_loadu_ps(orientation_w + i);
+
+		const __m128 xx = _mm_mul_ps(x, x);
+		const __m128 yy = _mm_mul_ps(y, y);
+		const __m128 zz = _mm_mul_ps(z, z);
+		const __m128 xy = _mm_mul_ps(x, y);
+		const __m128 xz = _mm_mul_ps(x, z);
+		const __m128 yz = _mm_mul_ps(y, z);
+		const __m128 wx = _mm_mul_ps(w, x);
+		const __m128 wy = _mm_mul_ps(w, y);
+		const __m128 wz = _mm_mul_ps(w, z);
+
+		// Same rotation matrix as the scalar lanes, four bodies at a time
+		const __m128 rotation[3][3] =
+		{
+			{
+				_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(yy, zz))),
+				_mm_mul_ps(two, _mm_sub_ps(xy, wz)),
+				_mm_mul_ps(two, _mm_add_ps(xz, wy))
+			},
+			{
+				_mm_mul_ps(two, _mm_add_ps(xy, wz)),
+				_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, zz))),
+				_mm_mul_ps(two, _mm_sub_ps(yz, wx))
+			},
+			{
+				_mm_mul_ps(two, _mm_sub_ps(xz, wy)),
+				_mm_mul_ps(two, _mm_add_ps(yz, wx)),
+				_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, yy)))
+			}
+		};
+
+		const __m128 local_center[3] = { _mm_loadu_ps(center[0] + i), _mm_loadu_ps(center[1] + i), _mm_loadu_ps(center[2] + i) };
+		const __m128 local_extent[3] = { _mm_loadu_ps(extent[0] + i), _mm_loadu_ps(extent[1] + i), _mm_loadu_ps(extent[2] + i) };
+
+		for (int k = 0; k < 3; k++)
+		{
+			__m128 world_center = _mm_loadu_ps(position[k] + i);
+			__m128 world_extent = zero;
+			for (int j = 0; j < 3; j++)
+			{
+				world_center = _mm_add_ps(world_center, _mm_mul_ps(rotation[k][j], local_center[j]));
+				world_extent = _mm_add_ps(world_extent, _mm_mul_ps(_mm_andnot_ps(sign_mask, rotation[k][j]), local_extent[j]));
+			}
+
+			const __m128 motion = _mm_mul_ps(_mm_loadu_ps(velocity[k] + i), dt);
+			const __m128 low = _mm_sub_ps(_mm_add_ps(_mm_sub_ps(world_center, world_extent), _mm_min_ps(motion, zero)), margin);
+			const __m128 high = _mm_add_ps(_mm_add_ps(_mm_add_ps(world_center, world_extent), _mm_max_ps(motion, zero)), margin);
+			_mm_storeu_ps(mins[k] + i, low);
+			_mm_storeu_ps(maxs[k] + i, high);
+		}
+	}
+}
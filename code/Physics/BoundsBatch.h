@@ -0,0 +1,51 @@
+#pragma once
+#include <vector>
+#include "BodyStore.h"
+#include "../Math/Bounds.h"
+
+
+/// <summary>
+/// Computes the swept world bounds of a whole list of bodies in one pass.
+/// The state of the bodies is copied into one array per component, so the bounds of four bodies are computed
+/// at once with SSE. The local box of a shape is moved to world space through the absolute value of the rotation
+/// matrix (world extent = |R| * local extent) instead of rotating its eight corners.
+/// </summary>
+class BoundsBatch
+{
+public:
+	// Fills outBounds with the bounds of every body, expanded by its linear velocity, same as GetSweptBounds
+	void ComputeSweptBounds(const BodyView& bodies, const float dt_sec, std::vector<Bounds>& outBounds);
+
+	// Reads the local box of every shape again on the next update (call it when the body list is replaced)
+	void Clear();
+
+private:
+	enum Stream
+	{
+		POSITION_X, POSITION_Y, POSITION_Z,
+		ORIENTATION_X, ORIENTATION_Y, ORIENTATION_Z, ORIENTATION_W,
+		VELOCITY_X, VELOCITY_Y, VELOCITY_Z,
+		CENTER_X, CENTER_Y, CENTER_Z,
+		EXTENT_X, EXTENT_Y, EXTENT_Z,
+		MIN_X, MIN_Y, MIN_Z,
+		MAX_X, MAX_Y, MAX_Z,
+		NUM_STREAMS
+	};
+
+	float* GetStream(const Stream stream) { return &streams[stream * stride]; }
+
+	void SetShapes(const BodyView& bodies);
+	void Gather(const BodyView& bodies);
+	void ComputeLanes(const int begin, const int end, const float dt_sec);
+	void ComputeLanesSSE(const int begin, const int end, const float dt_sec);
+
+	// Every stream holds stride floats, the number of bodies rounded up to a multiple of four
+	std::vector<float> streams;
+	int stride{ 0 };
+	int numBodies{ 0 };
+
+	// Bodies whose bounds don't depend on their orientation (spheres), they go through the identity rotation
+	std::vector<bool> ignoresRotation;
+	// Bodies already read since they fell asleep, they are skipped until they wake
+	std::vector<bool> gatheredAsleep;
+};
@@ -3,6 +3,8 @@
 #include "Shape.h"
 #include <vector>
 #include <algorithm>
+#include <iterator>
+#include <string.h>
 
 
 int CompareSAP(const void* a, const void* b) 
@@ -20,26 +22,67 @@ bool SortPseudoBodies(const PseudoBody& a, const PseudoBody& b)
 }
 
 
-void SortBodiesBounds(const std::vector<std::shared_ptr<Body>> bodies, const size_t num, std::vector<PseudoBody>& sortedArray, const float dt_sec)
+Bounds GetSweptBounds(const ConstBody& body, const float dt_sec)
 {
-	Vec3 axis = Vec3(1, 1, 1);
-	axis.Normalize();
+	Bounds bounds = body.shape->GetBounds(body.position, body.orientation);
 
-	for (int i = 0; i < num; i++)
+	// Expand the bounds by the linear velocity
+	bounds.Expand(bounds.mins + body.linearVelocity * dt_sec);
+	bounds.Expand(bounds.maxs + body.linearVelocity * dt_sec);
+
+	bounds.Expand(bounds.mins + Vec3(-1, -1, -1) * sweptBoundsMargin);
+	bounds.Expand(bounds.maxs + Vec3(1, 1, 1) * sweptBoundsMargin);
+
+	return bounds;
+}
+
+
+int GetSweepAxis(const std::vector<Bounds>& bodiesBounds, Vec3& variance)
+{
+	const size_t num = bodiesBounds.size();
+
+	Vec3 sum;
+	Vec3 sum_sqr;
+	for (int i = 0; i < (int)num; i++)
+	{
+		const Vec3 center = (bodiesBounds[i].mins + bodiesBounds[i].maxs) * 0.5f;
+		sum += center;
+		sum_sqr += Vec3(center.x * center.x, center.y * center.y, center.z * center.z);
+	}
+
+	variance.Zero();
+	if (num == 0) return 0;
+
+	const Vec3 mean = sum / (float)num;
+	const Vec3 mean_sqr = sum_sqr / (float)num;
+	variance = mean_sqr - Vec3(mean.x * mean.x, mean.y * mean.y, mean.z * mean.z);
+
+	int axis = 0;
+	if (variance[1] > variance[axis]) axis = 1;
+	if (variance[2] > variance[axis]) axis = 2;
+	return axis;
+}
+
+
+void SortBodiesBounds(const BodyStore& bodies, std::vector<PseudoBody>& sortedArray, std::vector<Bounds>& bodiesBounds, const float dt_sec)
+{
+	const size_t num = bodies.size();
+
+	for (int i = 0; i < (int)num; i++)
 	{
-		const std::shared_ptr<Body> body = bodies[i];
-		Bounds bounds = body->shape->GetBounds(body->position, body->orientation);
+		bodiesBounds.push_back(GetSweptBounds(bodies[i], dt_sec));
+	}
 
-		// Expand the bounds by the linear velocity
-		bounds.Expand(bounds.mins + body->linearVelocity * dt_sec);
-		bounds.Expand(bounds.maxs + body->linearVelocity * dt_sec);
+	// Sweep along the axis where the bodies are the most spread out, so the fewest intervals overlap
+	Vec3 variance;
+	const int axis = GetSweepAxis(bodiesBounds, variance);
 
-		const float epsilon = 0.01f;
-		bounds.Expand(bounds.mins + Vec3(-1, -1, -1) * epsilon);
-		bounds.Expand(bounds.maxs + Vec3(1, 1, 1) * epsilon);
+	for (int i = 0; i < (int)num; i++)
+	{
+		const Bounds& bounds = bodiesBounds[i];
 
-		sortedArray.push_back(PseudoBody{ i, axis.Dot(bounds.mins), true });
-		sortedArray.push_back(PseudoBody{ i, axis.Dot(bounds.maxs), false });
+		sortedArray.push_back(PseudoBody{ i, bounds.mins[axis], true });
+		sortedArray.push_back(PseudoBody{ i, bounds.maxs[axis], false });
 
 		/*sortedArray[i * 2 + 0].id = i;
 		sortedArray[i * 2 + 0].value = axis.Dot(bounds.mins);
@@ -55,9 +98,11 @@ void SortBodiesBounds(const std::vector<std::shared_ptr<Body>> bodies, const siz
 }
 
 
-void BuildPairs(std::vector<CollisionPair>& collisionPairs, const std::vector<PseudoBody>& sortedBodies, const int num)
+void BuildPairs(std::vector<CollisionPair>& collisionPairs, const std::vector<PseudoBody>& sortedBodies, const std::vector<Bounds>& bodiesBounds, const int num, BroadPhaseStats& stats)
 {
 	collisionPairs.clear();
+	stats.numSweptPairs = 0;
+	stats.numRejectedPairs = 0;
 
 	// Now that the bodies are sorted, build the collision pairs
 	for (int i = 0; i < num * 2; i++) 
@@ -76,6 +121,14 @@ void BuildPairs(std::vector<CollisionPair>& collisionPairs, const std::vector<Ps
 
 			if (!b.ismin) continue;
 
+			// The intervals overlap on the sweep axis, the bounds must overlap on the two other axes too
+			stats.numSweptPairs++;
+			if (!bodiesBounds[a.id].DoesIntersect(bodiesBounds[b.id]))
+			{
+				stats.numRejectedPairs++;
+				continue;
+			}
+
 			pair.b = b.id;
 			collisionPairs.push_back(pair);
 		}
@@ -83,19 +136,325 @@ void BuildPairs(std::vector<CollisionPair>& collisionPairs, const std::vector<Ps
 }
 
 
-void SweepAndPrune1D(const std::vector<std::shared_ptr<Body>> bodies, const size_t num, std::vector<CollisionPair>& finalPairs, const float dt_sec)
+void SweepAndPrune1D(const BodyStore& bodies, std::vector<CollisionPair>& finalPairs, const float dt_sec)
 {
+	const size_t num = bodies.size();
+
 	//PseudoBody* sortedBodies = (PseudoBody*)_malloca(sizeof(PseudoBody) * num * 2);
 	std::vector<PseudoBody> sortedBodies;
 	sortedBodies.reserve(num * 2);
+	std::vector<Bounds> bodiesBounds;
+	bodiesBounds.reserve(num);
+
+	BroadPhaseStats stats;
+	SortBodiesBounds(bodies, sortedBodies, bodiesBounds, dt_sec);
+	BuildPairs(finalPairs, sortedBodies, bodiesBounds, (int)num, stats);
+}
+
+int CountMismatchingPairs(const std::vector<CollisionPair>& lhs, const std::vector<CollisionPair>& rhs)
+{
+	auto sorted_keys = [](const std::vector<CollisionPair>& pairs)
+	{
+		std::vector<long long> keys;
+		keys.reserve(pairs.size());
+		for (const CollisionPair& pair : pairs)
+		{
+			const long long low = std::min(pair.a, pair.b);
+			const long long high = std::max(pair.a, pair.b);
+			keys.push_back((low << 32) | high);
+		}
+		std::sort(keys.begin(), keys.end());
+		return keys;
+	};
+
+	const std::vector<long long> lhs_keys = sorted_keys(lhs);
+	const std::vector<long long> rhs_keys = sorted_keys(rhs);
+
+	std::vector<long long> difference;
+	std::set_symmetric_difference(lhs_keys.begin(), lhs_keys.end(), rhs_keys.begin(), rhs_keys.end(), std::back_inserter(difference));
+	return (int)difference.size();
+}
+
+
+
+//=====================================
+// ====== PERSISTENT SWEEP AND PRUNE =====
+//=====================================
+
+void SweepAndPrune::Update(const std::vector<Bounds>& bodiesBounds, std::vector<CollisionPair>& finalPairs)
+{
+	const size_t num = bodiesBounds.size();
+
+	// Bodies are only identified by their index in the scene, so a removal shifts every id after it:
+	// in that case, or when a lot of bodies are added at once, sorting from scratch is cheaper
+	const size_t max_added_bodies = std::max<size_t>(8, numBodies / 4);
+	bool full_sort = false;
+	if (num < numBodies || num - numBodies > max_added_bodies)
+	{
+		Rebuild(num);
+		full_sort = true;
+	}
+	else if (num > numBodies)
+	{
+		AddBodies(numBodies, num);
+	}
+
+	// Changing the sweep axis shuffles every endpoint, the insertion sort would be quadratic
+	if (UpdateAxis(bodiesBounds))
+	{
+		full_sort = true;
+	}
+
+	UpdateValues(bodiesBounds);
+
+	if (full_sort)
+	{
+		std::sort(sortedBodies.begin(), sortedBodies.end(), SortPseudoBodies);
+	}
+	else
+	{
+		InsertionSort();
+	}
+
+	BuildPairs(finalPairs, sortedBodies, bodiesBounds, (int)num, stats);
+}
+
+void SweepAndPrune::Clear()
+{
+	sortedBodies.clear();
+	numBodies = 0;
+}
+
+void SweepAndPrune::Rebuild(const size_t num)
+{
+	Clear();
+	AddBodies(0, num);
+}
+
+void SweepAndPrune::AddBodies(const size_t first, const size_t num)
+{
+	sortedBodies.reserve(num * 2);
+	for (size_t i = first; i < num; i++)
+	{
+		sortedBodies.push_back(PseudoBody{ (int)i, 0.0f, true });
+		sortedBodies.push_back(PseudoBody{ (int)i, 0.0f, false });
+	}
+
+	numBodies = num;
+}
+
+bool SweepAndPrune::UpdateAxis(const std::vector<Bounds>& bodiesBounds)
+{
+	Vec3 variance;
+	const int best_axis = GetSweepAxis(bodiesBounds, variance);
+
+	// Only switch when the other axis is clearly better, so bodies moving around don't make the axis flicker
+	const float switch_ratio = 1.5f;
+	if (best_axis == axis || variance[best_axis] < variance[axis] * switch_ratio) return false;
 
-	SortBodiesBounds(bodies, num, sortedBodies, dt_sec);
-	BuildPairs(finalPairs, sortedBodies, num);
+	axis = best_axis;
+	return true;
 }
 
-void BroadPhase(const std::vector<std::shared_ptr<Body>> bodies, const int num, std::vector<CollisionPair>& finalPairs, const float dt_sec)
+void SweepAndPrune::UpdateValues(const std::vector<Bounds>& bodiesBounds)
 {
-	finalPairs.clear(); 
+	// Refresh the endpoints where they are, the order of the last step is kept
+	for (PseudoBody& pseudo_body : sortedBodies)
+	{
+		const Bounds& bounds = bodiesBounds[pseudo_body.id];
+		pseudo_body.value = pseudo_body.ismin ? bounds.mins[axis] : bounds.maxs[axis];
+	}
+}
+
+void SweepAndPrune::InsertionSort()
+{
+	// The endpoints are almost sorted already, so each of them only moves by a few slots
+	for (int i = 1; i < (int)sortedBodies.size(); i++)
+	{
+		const PseudoBody pseudo_body = sortedBodies[i];
+
+		int j = i - 1;
+		while (j >= 0 && sortedBodies[j].value > pseudo_body.value)
+		{
+			sortedBodies[j + 1] = sortedBodies[j];
+			j--;
+		}
+		sortedBodies[j + 1] = pseudo_body;
+	}
+}
+
+
+
+//=====================================
+// ====== PARALLEL SWEEP AND PRUNE =====
+//=====================================
+
+// Bodies handled by one task below which splitting the work costs more than it saves
+static const int minBodiesPerTask = 512;
+
+static unsigned int FloatToSortableKey(const float value)
+{
+	unsigned int bits;
+	memcpy(&bits, &value, sizeof(bits));
+
+	// Negative floats are ordered backward by their bits, flip them all. Positive ones just go above them.
+	return (bits & 0x80000000u) ? ~bits : (bits | 0x80000000u);
+}
+
+void ParallelSweepAndPrune::Update(const std::vector<Bounds>& bodiesBounds, std::vector<CollisionPair>& finalPairs, ThreadPool& threadPool)
+{
+	Vec3 variance;
+	axis = GetSweepAxis(bodiesBounds, variance);
+
+	BuildEndpoints(bodiesBounds, threadPool);
+	RadixSort(threadPool);
+	BuildPairs(bodiesBounds, finalPairs, threadPool);
+}
+
+void ParallelSweepAndPrune::BuildEndpoints(const std::vector<Bounds>& bodiesBounds, ThreadPool& threadPool)
+{
+	const int num = (int)bodiesBounds.size();
+
+	sortedBodies.resize(num * 2);
+	keys.resize(num * 2);
+
+	const int num_tasks = std::max(1, std::min(threadPool.GetNumThreads(), num / minBodiesPerTask));
+	threadPool.ParallelFor(num_tasks, [&](const int task)
+	{
+		int begin, end;
+		ThreadPool::GetTaskRange(task, num_tasks, num, begin, end);
+
+		for (int i = begin; i < end; i++)
+		{
+			const Bounds& bounds = bodiesBounds[i];
+
+			sortedBodies[i * 2 + 0] = PseudoBody{ i, bounds.mins[axis], true };
+			sortedBodies[i * 2 + 1] = PseudoBody{ i, bounds.maxs[axis], false };
+			keys[i * 2 + 0] = FloatToSortableKey(bounds.mins[axis]);
+			keys[i * 2 + 1] = FloatToSortableKey(bounds.maxs[axis]);
+		}
+	});
+}
+
+void ParallelSweepAndPrune::RadixSort(ThreadPool& threadPool)
+{
+	const int count = (int)keys.size();
+	tempBodies.resize(count);
+	tempKeys.resize(count);
+
+	const int num_buckets = 256;
+	const int num_tasks = std::max(1, std::min(threadPool.GetNumThreads(), count / minBodiesPerTask));
+	histograms.resize(num_tasks * num_buckets);
+
+	// Four stable passes of 8 bits, from the lowest to the highest byte of the keys
+	for (int shift = 0; shift < 32; shift += 8)
+	{
+		threadPool.ParallelFor(num_tasks, [&](const int task)
+		{
+			int begin, end;
+			ThreadPool::GetTaskRange(task, num_tasks, count, begin, end);
+
+			int* histogram = &histograms[task * num_buckets];
+			std::fill(histogram, histogram + num_buckets, 0);
+			for (int i = begin; i < end; i++)
+			{
+				histogram[(keys[i] >> shift) & 0xff]++;
+			}
+		});
+
+		// Turn the counts into the first output slot of each bucket for each task.
+		// Tasks come in order inside a bucket, which keeps the sort stable.
+		int offset = 0;
+		bool single_bucket = false;
+		for (int bucket = 0; bucket < num_buckets; bucket++)
+		{
+			int bucket_count = 0;
+			for (int task = 0; task < num_tasks; task++)
+			{
+				const int task_count = histograms[task * num_buckets + bucket];
+				histograms[task * num_buckets + bucket] = offset;
+				offset += task_count;
+				bucket_count += task_count;
+			}
+			if (bucket_count == count) single_bucket = true;
+		}
+
+		// Every key has the same byte here, the pass wouldn't move anything
+		if (single_bucket) continue;
+
+		threadPool.ParallelFor(num_tasks, [&](const int task)
+		{
+			int begin, end;
+			ThreadPool::GetTaskRange(task, num_tasks, count, begin, end);
+
+			int* histogram = &histograms[task * num_buckets];
+			for (int i = begin; i < end; i++)
+			{
+				const int slot = histogram[(keys[i] >> shift) & 0xff]++;
+				tempKeys[slot] = keys[i];
+				tempBodies[slot] = sortedBodies[i];
+			}
+		});
+
+		keys.swap(tempKeys);
+		sortedBodies.swap(tempBodies);
+	}
+}
+
+void ParallelSweepAndPrune::BuildPairs(const std::vector<Bounds>& bodiesBounds, std::vector<CollisionPair>& finalPairs, ThreadPool& threadPool)
+{
+	const int count = (int)sortedBodies.size();
+
+	// The scan cost of an endpoint depends on how crowded its surroundings are, use more tasks than threads to balance them
+	const int num_tasks = std::max(1, std::min(threadPool.GetNumThreads() * 4, count / minBodiesPerTask));
+	if ((int)taskPairs.size() < num_tasks)
+	{
+		taskPairs.resize(num_tasks);
+		taskStats.resize(num_tasks);
+	}
+
+	threadPool.ParallelFor(num_tasks, [&](const int task)
+	{
+		int begin, end;
+		ThreadPool::GetTaskRange(task, num_tasks, count, begin, end);
+
+		std::vector<CollisionPair>& pairs = taskPairs[task];
+		BroadPhaseStats& task_stats = taskStats[task];
+		pairs.clear();
+		task_stats = BroadPhaseStats();
+
+		for (int i = begin; i < end; i++)
+		{
+			const PseudoBody& a = sortedBodies[i];
+			if (!a.ismin) continue;
 
-	SweepAndPrune1D(bodies, num, finalPairs, dt_sec); 
+			for (int j = i + 1; j < count; j++)
+			{
+				const PseudoBody& b = sortedBodies[j];
+
+				if (b.id == a.id) break;
+
+				if (!b.ismin) continue;
+
+				task_stats.numSweptPairs++;
+				if (!bodiesBounds[a.id].DoesIntersect(bodiesBounds[b.id]))
+				{
+					task_stats.numRejectedPairs++;
+					continue;
+				}
+
+				pairs.push_back(CollisionPair{ a.id, b.id });
+			}
+		}
+	});
+
+	// Tasks cover consecutive endpoint ranges, appending them in task order gives the serial order
+	finalPairs.clear();
+	stats = BroadPhaseStats();
+	for (int task = 0; task < num_tasks; task++)
+	{
+		finalPairs.insert(finalPairs.end(), taskPairs[task].begin(), taskPairs[task].end());
+		stats.numSweptPairs += taskStats[task].numSweptPairs;
+		stats.numRejectedPairs += taskStats[task].numRejectedPairs;
+	}
 }
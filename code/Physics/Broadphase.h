@@ -1,7 +1,9 @@
 #pragma once
 #include <vector>
 #include <memory>
-#include "Body.h"
+#include "BodyStore.h"
+#include "../Math/Bounds.h"
+#include "ThreadPool.h"
 
 struct CollisionPair
 {
@@ -26,4 +28,99 @@ struct PseudoBody
 	bool ismin;
 };
 
-void BroadPhase(const std::vector<std::shared_ptr<Body>> bodies, const int num, std::vector<CollisionPair>& finalPairs, const float dt_sec);
\ No newline at end of file
+struct BroadPhaseStats
+{
+	// Candidate pairs found by the broadphase structure (overlapping on the sweep axis, on the fat bounds of the tree or sharing a grid cell)
+	int numSweptPairs{ 0 };
+	// Candidates culled because their bounds don't overlap on all three axes
+	int numRejectedPairs{ 0 };
+
+	float GetRejectionRate() const { return numSweptPairs > 0 ? (float)numRejectedPairs / (float)numSweptPairs : 0.0f; }
+};
+
+enum class BroadPhaseType
+{
+	SWEEP_AND_PRUNE,
+	DYNAMIC_TREE,
+	HASH_GRID,
+	PARALLEL_SWEEP_AND_PRUNE
+};
+
+// Margin added around the swept bounds of every body
+const float sweptBoundsMargin = 0.01f;
+
+Bounds GetSweptBounds(const ConstBody& body, const float dt_sec);
+
+// Returns the world axis (0 = x, 1 = y, 2 = z) along which the centers of the bounds are the most spread out
+int GetSweepAxis(const std::vector<Bounds>& bodiesBounds, Vec3& variance);
+
+// Stateless sweep and prune, sorting every body from scratch. Kept as the reference the other backends are checked against.
+void SweepAndPrune1D(const BodyStore& bodies, std::vector<CollisionPair>& finalPairs, const float dt_sec);
+
+// Returns the number of pairs found in only one of the two lists, whatever their order
+int CountMismatchingPairs(const std::vector<CollisionPair>& lhs, const std::vector<CollisionPair>& rhs);
+
+
+/// <summary>
+/// Sweep and prune that keeps the sorted endpoints of the previous step.
+/// Bodies barely move between two steps, so the endpoint values are refreshed in place
+/// and an insertion sort puts them back in order in near linear time.
+/// </summary>
+class SweepAndPrune
+{
+public:
+	// Finds the overlapping pairs among the swept bounds of the bodies, one per body
+	void Update(const std::vector<Bounds>& bodiesBounds, std::vector<CollisionPair>& finalPairs);
+
+	// Forces a full rebuild on the next update (call it when the body list is replaced)
+	void Clear();
+
+	const BroadPhaseStats& GetStats() const { return stats; }
+
+private:
+	void Rebuild(const size_t num);
+	void AddBodies(const size_t first, const size_t num);
+	bool UpdateAxis(const std::vector<Bounds>& bodiesBounds);
+	void UpdateValues(const std::vector<Bounds>& bodiesBounds);
+	void InsertionSort();
+
+	std::vector<PseudoBody> sortedBodies;
+	size_t numBodies{ 0 };
+	int axis{ 0 };
+
+	BroadPhaseStats stats;
+};
+
+
+/// <summary>
+/// Sweep and prune spreading its work over a thread pool, for scenes with thousands of bodies.
+/// Endpoints are built in parallel, sorted with a parallel LSD radix sort on the float values,
+/// and the pair scan is split in ranges of endpoints whose pairs are merged back in order,
+/// so the pairs come out in the same order whatever the number of threads.
+/// </summary>
+class ParallelSweepAndPrune
+{
+public:
+	void Update(const std::vector<Bounds>& bodiesBounds, std::vector<CollisionPair>& finalPairs, ThreadPool& threadPool);
+
+	const BroadPhaseStats& GetStats() const { return stats; }
+
+private:
+	void BuildEndpoints(const std::vector<Bounds>& bodiesBounds, ThreadPool& threadPool);
+	void RadixSort(ThreadPool& threadPool);
+	void BuildPairs(const std::vector<Bounds>& bodiesBounds, std::vector<CollisionPair>& finalPairs, ThreadPool& threadPool);
+
+	std::vector<PseudoBody> sortedBodies;
+	std::vector<PseudoBody> tempBodies;
+	std::vector<unsigned int> keys;
+	std::vector<unsigned int> tempKeys;
+	int axis{ 0 };
+
+	// One 256 bucket histogram per task, for each radix pass
+	std::vector<int> histograms;
+	// Pairs and statistics of each task of the pair scan, merged in task order
+	std::vector<std::vector<CollisionPair>> taskPairs;
+	std::vector<BroadPhaseStats> taskStats;
+
+	BroadPhaseStats stats;
+};
\ No newline at end of file
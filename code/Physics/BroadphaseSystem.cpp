@@ -0,0 +1,135 @@
+#include "BroadphaseSystem.h"
+#include <algorithm>
+
+
+void BroadPhase::Update(const BodyStore& bodies, const float dt_sec)
+{
+	UpdateBodyPartition(bodies);
+
+	// Only the moving bodies go through the backend, with their index in dynamicIds
+	boundsBatch.ComputeSweptBounds(BodyView(bodies, dynamicIds), dt_sec, dynamicBounds);
+	switch (type)
+	{
+	case BroadPhaseType::SWEEP_AND_PRUNE:
+		sweepAndPrune.Update(dynamicBounds, pairs);
+		break;
+	case BroadPhaseType::DYNAMIC_TREE:
+		treeBroadPhase.Update(dynamicBounds, pairs);
+		break;
+	case BroadPhaseType::HASH_GRID:
+		hashGridBroadPhase.Update(dynamicBounds, pairs);
+		break;
+	case BroadPhaseType::PARALLEL_SWEEP_AND_PRUNE:
+		parallelSweepAndPrune.Update(dynamicBounds, pairs, threadPool);
+		break;
+	}
+
+	// Two sleeping bodies can't collide, only the pairs with an awake body are kept
+	pairs.erase(std::remove_if(pairs.begin(), pairs.end(), [&](const CollisionPair& pair)
+	{
+		return bodies.sleeps[dynamicIds[pair.a]].isSleeping && bodies.sleeps[dynamicIds[pair.b]].isSleeping;
+	}), pairs.end());
+
+	for (CollisionPair& pair : pairs)
+	{
+		pair.a = dynamicIds[pair.a];
+		pair.b = dynamicIds[pair.b];
+	}
+
+	// Then each awake body looks for the static bodies it overlaps
+	if (staticBroadPhase.GetNumBodies() > 0)
+	{
+		for (int i = 0; i < (int)dynamicIds.size(); i++)
+		{
+			if (bodies.sleeps[dynamicIds[i]].isSleeping) continue;
+
+			staticBroadPhase.Query(dynamicIds[i], dynamicBounds[i], pairs);
+		}
+	}
+
+	numMismatchingPairs = validate ? Validate(bodies, dt_sec) : 0;
+}
+
+void BroadPhase::Clear()
+{
+	sweepAndPrune.Clear();
+	treeBroadPhase.Clear();
+	hashGridBroadPhase.Clear();
+	staticBroadPhase.Clear();
+	boundsBatch.Clear();
+
+	numBodies = 0;
+	dynamicIds.clear();
+	staticIds.clear();
+	pairs.clear();
+}
+
+const BroadPhaseStats& BroadPhase::GetStats() const
+{
+	switch (type)
+	{
+	case BroadPhaseType::DYNAMIC_TREE: return treeBroadPhase.GetStats();
+	case BroadPhaseType::HASH_GRID: return hashGridBroadPhase.GetStats();
+	case BroadPhaseType::PARALLEL_SWEEP_AND_PRUNE: return parallelSweepAndPrune.GetStats();
+	default: return sweepAndPrune.GetStats();
+	}
+}
+
+void BroadPhase::UpdateBodyPartition(const BodyStore& bodies)
+{
+	if (numBodies == bodies.size() && storeVersion == bodies.GetVersion()) return;
+
+	// Bodies are only identified by their index, so anything else than bodies added at the end needs a full partition,
+	// even when as many bodies were created as destroyed: the destroyed ones were filled by bodies moved from the end
+	const bool removed = storeRemovalVersion != bodies.GetRemovalVersion() || bodies.size() < numBodies;
+	bool rebuild_statics = numBodies == 0 || removed;
+	if (removed)
+	{
+		// The backends know the moving bodies by their rank in dynamicIds, which changes too
+		sweepAndPrune.Clear();
+		treeBroadPhase.Clear();
+		hashGridBroadPhase.Clear();
+		boundsBatch.Clear();
+
+		numBodies = 0;
+		dynamicIds.clear();
+		staticIds.clear();
+	}
+
+	for (int i = numBodies; i < bodies.size(); i++)
+	{
+		if (bodies.inverseMasses[i] == 0.0f)
+		{
+			staticIds.push_back(i);
+			rebuild_statics = true;
+			continue;
+		}
+
+		dynamicIds.push_back(i);
+	}
+	numBodies = bodies.size();
+	storeVersion = bodies.GetVersion();
+	storeRemovalVersion = bodies.GetRemovalVersion();
+
+	if (rebuild_statics)
+	{
+		staticBroadPhase.Build(bodies, staticIds);
+	}
+}
+
+int BroadPhase::Validate(const BodyStore& bodies, const float dt_sec)
+{
+	SweepAndPrune1D(bodies, referencePairs, dt_sec);
+
+	// Pairs without any awake moving body are never generated
+	auto is_awake = [&](const int id)
+	{
+		return bodies.inverseMasses[id] != 0.0f && !bodies.sleeps[id].isSleeping;
+	};
+	referencePairs.erase(std::remove_if(referencePairs.begin(), referencePairs.end(), [&](const CollisionPair& pair)
+	{
+		return !is_awake(pair.a) && !is_awake(pair.b);
+	}), referencePairs.end());
+
+	return CountMismatchingPairs(pairs, referencePairs);
+}
@@ -0,0 +1,69 @@
+#pragma once
+#include <vector>
+#include "BodyStore.h"
+#include "Broadphase.h"
+#include "BoundsBatch.h"
+#include "DynamicTree.h"
+#include "HashGrid.h"
+#include "ThreadPool.h"
+
+
+/// <summary>
+/// Stateful broadphase owned by the scene.
+/// Moving bodies go through the selected backend and then query the static bodies, which are
+/// only inserted once. Bodies are read through their index in the store and every buffer is kept from
+/// one step to the next, so a step where no body is added makes no heap allocation.
+/// </summary>
+class BroadPhase
+{
+public:
+	BroadPhase(ThreadPool& threadPoolP) : threadPool(threadPoolP) {}
+
+	// Finds the pairs of bodies whose swept bounds overlap, pairs without any awake moving body excluded
+	void Update(const BodyStore& bodies, const float dt_sec);
+
+	// Forgets every body (call it when the body list is replaced)
+	void Clear();
+
+	// Pairs found by the last update, with the index of the bodies in the scene
+	const std::vector<CollisionPair>& GetPairs() const { return pairs; }
+	const BroadPhaseStats& GetStats() const;
+	// Pairs of the last update missing from the reference sweep and prune or not in it, 0 when validate is off
+	int GetNumMismatchingPairs() const { return numMismatchingPairs; }
+
+	// Backend used to find the pairs between moving bodies
+	BroadPhaseType type{ BroadPhaseType::SWEEP_AND_PRUNE };
+	// Compares the pairs with the stateless sweep and prune each step (slow, for debugging)
+	bool validate{ false };
+
+private:
+	void UpdateBodyPartition(const BodyStore& bodies);
+	// Number of pairs differing from the stateless sweep and prune
+	int Validate(const BodyStore& bodies, const float dt_sec);
+
+	ThreadPool& threadPool;
+
+	// Swept bounds of the moving bodies, computed in one batch and read by every backend
+	BoundsBatch boundsBatch;
+	std::vector<Bounds> dynamicBounds;
+
+	SweepAndPrune sweepAndPrune;
+	TreeBroadPhase treeBroadPhase;
+	HashGridBroadPhase hashGridBroadPhase;
+	ParallelSweepAndPrune parallelSweepAndPrune;
+
+	// Bodies with an infinite mass, built when the body list changes and then only queried
+	StaticBroadPhase staticBroadPhase;
+
+	// Number of bodies partitioned, the partition is only refreshed when the store version changes
+	int numBodies{ 0 };
+	unsigned int storeVersion{ 0 };
+	unsigned int storeRemovalVersion{ 0 };
+	// Scene index of the moving bodies, the backends get them in this order
+	std::vector<int> dynamicIds;
+	std::vector<int> staticIds;
+
+	std::vector<CollisionPair> pairs;
+	std::vector<CollisionPair> referencePairs;
+	int numMismatchingPairs{ 0 };
+};
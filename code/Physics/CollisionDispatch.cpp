@@ -0,0 +1,167 @@
+#include "CollisionDispatch.h"
+#include "Intersections.h"
+#include <array>
+#include <utility>
+
+
+void PairBatch::Clear(const BodyStore& bodiesP)
+{
+	bodies = &bodiesP;
+	idsA.clear();
+	idsB.clear();
+	contacts.clear();
+	hits.clear();
+}
+
+int PairBatch::Add(const int idA, const int idB)
+{
+	idsA.push_back(idA);
+	idsB.push_back(idB);
+	return (int)idsA.size() - 1;
+}
+
+
+
+//=====================================
+// ======== PER PAIR KERNELS ==========
+//=====================================
+
+// Runs the single pair kernel over every pair of the batch
+template<typename Kernel>
+struct PairLoop
+{
+	static void IntersectBatch(PairBatch& batch, const float dt)
+	{
+		const int num = batch.GetNumPairs();
+		batch.contacts.resize(num);
+		batch.hits.resize(num);
+
+		for (int i = 0; i < num; i++)
+		{
+			batch.hits[i] = Kernel::Intersect(batch.GetBodyA(i), batch.GetBodyB(i), dt, batch.contacts[i]);
+		}
+	}
+};
+
+// Pairs of types without a kernel yet never collide
+template<Shape::ShapeType TypeA, Shape::ShapeType TypeB>
+struct PairKernel : PairLoop<PairKernel<TypeA, TypeB>>
+{
+	static bool Intersect(const ConstBody& /*a*/, const ConstBody& /*b*/, const float /*dt*/, Contact& /*contact*/)
+	{
+		return false;
+	}
+};
+
+template<>
+struct PairKernel<Shape::ShapeType::SHAPE_SPHERE, Shape::ShapeType::SHAPE_SPHERE>
+{
+	static bool Intersect(const ConstBody& a, const ConstBody& b, const float dt, Contact& contact)
+	{
+		const ShapeSphere* sphere_a = static_cast<const ShapeSphere*>(a.shape);
+		const ShapeSphere* sphere_b = static_cast<const ShapeSphere*>(b.shape);
+
+		if (!Intersections::SphereSphereDynamic(*sphere_a, *sphere_b, a.position, b.position, a.linearVelocity, b.linearVelocity, dt,
+			contact.ptOnAWorldSpace, contact.ptOnBWorldSpace, contact.timeOfImpact)) return false;
+
+		Intersections::CompleteSphereContact(a, b, contact);
+		return true;
+	}
+
+	// Gathers the spheres in SoA streams and solves them several at a time
+	static void IntersectBatch(PairBatch& batch, const float dt)
+	{
+		if (!batch.useSimd)
+		{
+			PairLoop<PairKernel>::IntersectBatch(batch, dt);
+			return;
+		}
+
+		const int num = batch.GetNumPairs();
+		batch.contacts.resize(num);
+		batch.hits.resize(num);
+
+		// Read straight from the arrays of the store, without building a view per body
+		const BodyStore& bodies = *batch.bodies;
+		SpherePairBatch& spheres = batch.spheres;
+		spheres.Clear();
+		for (int i = 0; i < num; i++)
+		{
+			const int a = batch.idsA[i];
+			const int b = batch.idsB[i];
+			const float radius_a = static_cast<const ShapeSphere*>(bodies.shapes[a])->radius;
+			const float radius_b = static_cast<const ShapeSphere*>(bodies.shapes[b])->radius;
+			spheres.Add(bodies.positions[a], bodies.linearVelocities[a], radius_a, bodies.positions[b], bodies.linearVelocities[b], radius_b);
+		}
+
+		spheres.Solve(dt);
+
+		for (int i = 0; i < num; i++)
+		{
+			Contact& contact = batch.contacts[i];
+			const bool hit = spheres.GetResult(i, contact.ptOnAWorldSpace, contact.ptOnBWorldSpace, contact.timeOfImpact);
+			if (hit)
+			{
+				Intersections::CompleteSphereContact(batch.GetBodyA(i), batch.GetBodyB(i), contact);
+			}
+			batch.hits[i] = hit;
+		}
+	}
+};
+// Any pair of convex shapes goes through GJK, advanced in time until the shapes touch
+struct ConvexPairKernel : PairLoop<ConvexPairKernel>
+{
+	static bool Intersect(const ConstBody& a, const ConstBody& b, const float dt, Contact& contact)
+	{
+		return Intersections::ConservativeAdvance(a, b, dt, contact);
+	}
+};
+
+template<>
+struct PairKernel<Shape::ShapeType::SHAPE_BOX, Shape::ShapeType::SHAPE_BOX> : ConvexPairKernel {};
+template<>
+struct PairKernel<Shape::ShapeType::SHAPE_BOX, Shape::ShapeType::SHAPE_SPHERE> : ConvexPairKernel {};
+template<>
+struct PairKernel<Shape::ShapeType::SHAPE_SPHERE, Shape::ShapeType::SHAPE_BOX> : ConvexPairKernel {};
+template<>
+struct PairKernel<Shape::ShapeType::SHAPE_CONVEX, Shape::ShapeType::SHAPE_CONVEX> : ConvexPairKernel {};
+template<>
+struct PairKernel<Shape::ShapeType::SHAPE_CONVEX, Shape::ShapeType::SHAPE_BOX> : ConvexPairKernel {};
+template<>
+struct PairKernel<Shape::ShapeType::SHAPE_BOX, Shape::ShapeType::SHAPE_CONVEX> : ConvexPairKernel {};
+template<>
+struct PairKernel<Shape::ShapeType::SHAPE_CONVEX, Shape::ShapeType::SHAPE_SPHERE> : ConvexPairKernel {};
+template<>
+struct PairKernel<Shape::ShapeType::SHAPE_SPHERE, Shape::ShapeType::SHAPE_CONVEX> : ConvexPairKernel {};
+
+
+
+//=====================================
+// ===== COLLISION FUNCTION MATRIX ====
+//=====================================
+
+// Cell i of a matrix holds the kernel of (ShapeType)(i / numShapeTypes) against (ShapeType)(i % numShapeTypes)
+template<size_t... Cells>
+constexpr std::array<PairFunction, sizeof...(Cells)> MakePairFunctions(std::index_sequence<Cells...>)
+{
+	return {{ &PairKernel<(Shape::ShapeType)(Cells / Shape::numShapeTypes), (Shape::ShapeType)(Cells % Shape::numShapeTypes)>::Intersect... }};
+}
+
+template<size_t... Cells>
+constexpr std::array<PairBatchFunction, sizeof...(Cells)> MakePairBatchFunctions(std::index_sequence<Cells...>)
+{
+	return {{ &PairKernel<(Shape::ShapeType)(Cells / Shape::numShapeTypes), (Shape::ShapeType)(Cells % Shape::numShapeTypes)>::IntersectBatch... }};
+}
+
+static constexpr std::array<PairFunction, numShapePairTypes> pairFunctions = MakePairFunctions(std::make_index_sequence<numShapePairTypes>());
+static constexpr std::array<PairBatchFunction, numShapePairTypes> pairBatchFunctions = MakePairBatchFunctions(std::make_index_sequence<numShapePairTypes>());
+
+PairFunction GetPairFunction(const int shapePairType)
+{
+	return pairFunctions[shapePairType];
+}
+
+PairBatchFunction GetPairBatchFunction(const int shapePairType)
+{
+	return pairBatchFunctions[shapePairType];
+}
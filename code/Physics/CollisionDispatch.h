@@ -0,0 +1,56 @@
+#pragma once
+#include <vector>
+#include "BodyStore.h"
+#include "Shape.h"
+#include "Contact.h"
+#include "SphereBatch.h"
+
+
+// Index of the (typeA, typeB) cell in the collision function matrix
+inline int GetShapePairType(const Shape::ShapeType typeA, const Shape::ShapeType typeB)
+{
+	return (int)typeA * Shape::numShapeTypes + (int)typeB;
+}
+
+const int numShapePairTypes = Shape::numShapeTypes * Shape::numShapeTypes;
+
+
+/// <summary>
+/// Pairs of bodies whose shapes all have the same types, tested together by the kernel of that pair of types.
+/// Each kernel knows the exact shapes it gets, so it runs without any virtual call nor branch on the type.
+/// </summary>
+class PairBatch
+{
+public:
+	// Empties the batch, the pairs added next are bodies of this store
+	void Clear(const BodyStore& bodiesP);
+
+	// Adds the pair of the bodies of these indices and returns its index in the batch
+	int Add(const int idA, const int idB);
+
+	int GetNumPairs() const { return (int)idsA.size(); }
+
+	ConstBody GetBodyA(const int pair) const { return (*bodies)[idsA[pair]]; }
+	ConstBody GetBodyB(const int pair) const { return (*bodies)[idsB[pair]]; }
+
+	const BodyStore* bodies{ nullptr };
+	std::vector<int> idsA;
+	std::vector<int> idsB;
+
+	// Results of the kernel, the contact of a pair is only filled if it hits
+	std::vector<Contact> contacts;
+	std::vector<bool> hits;
+
+	// Solves the pairs with the SIMD kernels when there is one
+	bool useSimd{ true };
+	SpherePairBatch spheres;
+};
+
+
+typedef bool (*PairFunction)(const ConstBody& a, const ConstBody& b, const float dt, Contact& contact);
+typedef void (*PairBatchFunction)(PairBatch& batch, const float dt);
+
+// Kernel testing a single pair of shapes of these types
+PairFunction GetPairFunction(const int shapePairType);
+// Kernel testing a whole batch of pairs of shapes of these types
+PairBatchFunction GetPairBatchFunction(const int shapePairType);
@@ -1,24 +1,37 @@
 #pragma once
-#include <memory>
+#include <type_traits>
 #include "../Math/Vector.h"
-#include "Body.h"
+#include "BodyStore.h"
 
+// How ResolveContact separates bodies already overlapping at the start of the step
+enum class PenetrationCorrection
+{
+	// Moves the bodies out of each other at once, split by their inverse mass
+	SNAP,
+	// Leaves the positions alone, the caller pushes the bodies apart with pseudo velocities (see ContactScheduler)
+	SPLIT_IMPULSE
+};
+
+/// <summary>
+/// Plain record of a contact between two bodies of the scene, referred to by their index.
+/// It holds no pointer into the store and is trivially copyable, so lists of contacts are copied and grown as raw memory.
+/// Contacts are never sorted themselves: the ones to resolve in order are picked through keys and indices (see ContactScheduler).
+/// </summary>
 class Contact
 {
 public:
+	// Index of the bodies in the scene
+	int idA;
+	int idB;
+	float timeOfImpact;
+	float separationDistance;
+	Vec3 normal;
 	Vec3 ptOnAWorldSpace;
-	Vec3 ptOnALocalSpace;
 	Vec3 ptOnBWorldSpace;
+	Vec3 ptOnALocalSpace;
 	Vec3 ptOnBLocalSpace;
-	Vec3 normal;
-	float separationDistance;
-	float timeOfImpact;
-
-	std::shared_ptr<Body> a;
-	std::shared_ptr<Body> b;
-
-	static void ResolveContact(Contact& contact);
 
-	static int CompareContact(const void* p1, const void* p2);
-	static bool SortContacts(const Contact& a, const Contact& b);
+	// Applies the impulses of the contact to its bodies, and returns the impulse applied along the normal
+	static float ResolveContact(BodyStore& bodies, const Contact& contact, const PenetrationCorrection correction = PenetrationCorrection::SNAP);
 };
+static_assert(std::is_trivially_copyable<Contact>::value, "Contact lists are copied as raw memory");
@@ -0,0 +1,306 @@
+#include "ContactScheduler.h"
+#include "Intersections.h"
+#include "Islands.h"
+#include <algorithm>
+#include <functional>
+
+
+void ContactScheduler::Resolve(BodyStore& bodiesP, const Islands& islandsP, const int island,
+	const std::vector<Contact>& contacts, PairCache& pairCache, const float dt_sec)
+{
+	bodies = &bodiesP;
+	islands = &islandsP;
+	foundContacts = &contacts;
+	stepTime = dt_sec;
+	currentTime = 0.0f;
+	numResolved = 0;
+
+	const Island& current_island = islandsP.GetIsland(island);
+	const int num_bodies = current_island.numBodies;
+	bodyStates.assign(num_bodies, BodyState{});
+
+	// Pairs of every body, to know which ones to test again after one of its contacts
+	const CollisionPair* pairs = islandsP.GetPairs().data() + current_island.firstPair;
+	const int num_pairs = current_island.numPairs;
+	pairOffsets.assign(num_bodies + 1, 0);
+	for (int p = 0; p < num_pairs; p++)
+	{
+		const int local_a = islandsP.GetLocalIndex(pairs[p].a);
+		const int local_b = islandsP.GetLocalIndex(pairs[p].b);
+		if (local_a >= 0) pairOffsets[local_a + 1]++;
+		if (local_b >= 0) pairOffsets[local_b + 1]++;
+	}
+	for (int i = 0; i < num_bodies; i++)
+	{
+		pairOffsets[i + 1] += pairOffsets[i];
+	}
+
+	pairOthers.resize(pairOffsets[num_bodies]);
+	pairFill.assign(pairOffsets.begin(), pairOffsets.end() - 1);
+	for (int p = 0; p < num_pairs; p++)
+	{
+		const int local_a = islandsP.GetLocalIndex(pairs[p].a);
+		const int local_b = islandsP.GetLocalIndex(pairs[p].b);
+		if (local_a >= 0) pairOthers[pairFill[local_a]++] = pairs[p].b;
+		if (local_b >= 0) pairOthers[pairFill[local_b]++] = pairs[p].a;
+	}
+
+	// The contacts of the narrow phase are scheduled where they are, only the ones found during the step are stored
+	islandContacts = islandsP.GetContacts().data() + current_island.firstContact;
+	numIslandContacts = current_island.numContacts;
+	predictedContacts.clear();
+	queue.clear();
+	overlappingContacts.clear();
+	for (int c = 0; c < numIslandContacts; c++)
+	{
+		Schedule(c);
+	}
+
+	while (!queue.empty())
+	{
+		std::pop_heap(queue.begin(), queue.end(), std::greater<Event>());
+		const Event event = queue.back();
+		queue.pop_back();
+
+		// One of the bodies changed its velocities since, its pairs have been predicted again
+		if (IsStale(event)) continue;
+
+		const Contact& contact = GetContact(event.contact);
+		currentTime = event.timeOfImpact;
+		AdvanceBody(contact.idA, currentTime);
+		AdvanceBody(contact.idB, currentTime);
+
+		const float normal_impulse = Contact::ResolveContact(*bodies, contact, settings.penetrationCorrection);
+		numResolved++;
+
+		if (contact.timeOfImpact == 0.0f && settings.penetrationCorrection == PenetrationCorrection::SPLIT_IMPULSE)
+		{
+			overlappingContacts.push_back(event.contact);
+		}
+
+		// Kept for the solver to start from on the next step
+		CachedPair* cached_pair = pairCache.Find(contact.idA, contact.idB);
+		if (cached_pair)
+		{
+			cached_pair->normalImpulse = normal_impulse;
+		}
+
+		// Bodies with an infinite mass keep their velocities, their other contacts are still right
+		const int id_a = contact.idA;
+		const int id_b = contact.idB;
+		const bool moved_a = GetState(id_a) != nullptr;
+		const bool moved_b = GetState(id_b) != nullptr;
+		if (moved_a) OnImpact(id_a);
+		if (moved_b) OnImpact(id_b);
+
+		// The pair itself is tested with the pairs of A, or of B if A didn't move
+		if (moved_a) PredictPairs(id_a, -1);
+		if (moved_b) PredictPairs(id_b, moved_a ? id_a : -1);
+	}
+
+	// Moves the bodies for the rest of the step
+	const int* island_bodies = islandsP.GetBodies().data() + current_island.firstBody;
+	for (int i = 0; i < num_bodies; i++)
+	{
+		AdvanceBody(island_bodies[i], stepTime);
+	}
+
+	if (!overlappingContacts.empty())
+	{
+		ResolvePenetrations(island_bodies, num_bodies);
+	}
+}
+
+void ContactScheduler::Clear()
+{
+	predictedContacts.clear();
+	foundContacts = nullptr;
+	islandContacts = nullptr;
+	numIslandContacts = 0;
+	queue.clear();
+	overlappingContacts.clear();
+	penetrations.clear();
+	bodies = nullptr;
+	islands = nullptr;
+}
+
+ContactScheduler::BodyState* ContactScheduler::GetState(const int id)
+{
+	const int local_index = islands->GetLocalIndex(id);
+	return local_index < 0 ? nullptr : &bodyStates[local_index];
+}
+
+unsigned int ContactScheduler::GetVersion(const int id) const
+{
+	const int local_index = islands->GetLocalIndex(id);
+	return local_index < 0 ? 0 : bodyStates[local_index].version;
+}
+
+const Contact& ContactScheduler::GetContact(const int index) const
+{
+	if (index < numIslandContacts) return (*foundContacts)[islandContacts[index]];
+	return predictedContacts[index - numIslandContacts];
+}
+
+void ContactScheduler::Schedule(const int index)
+{
+	const Contact& contact = GetContact(index);
+
+	// Bodies with infinite masses don't react to each other
+	if (bodies->inverseMasses[contact.idA] == 0.0f && bodies->inverseMasses[contact.idB] == 0.0f) return;
+
+	Event event;
+	event.timeOfImpact = contact.timeOfImpact;
+	event.contact = index;
+	event.versionA = GetVersion(contact.idA);
+	event.versionB = GetVersion(contact.idB);
+
+	queue.push_back(event);
+	std::push_heap(queue.begin(), queue.end(), std::greater<Event>());
+}
+
+void ContactScheduler::AdvanceBody(const int id, const float time)
+{
+	// Bodies with an infinite mass are shared by islands, they are moved once all islands are done
+	BodyState* state = GetState(id);
+	if (!state) return;
+
+	const float dt = time - state->localTime;
+	if (dt <= 0.0f) return;
+
+	(*bodies)[id].Update(dt);
+	state->localTime = time;
+}
+
+void ContactScheduler::OnImpact(const int id)
+{
+	BodyState* state = GetState(id);
+	state->version++;
+	state->numImpacts++;
+}
+
+bool ContactScheduler::IsStale(const Event& event) const
+{
+	const Contact& contact = GetContact(event.contact);
+	return GetVersion(contact.idA) != event.versionA || GetVersion(contact.idB) != event.versionB;
+}
+
+void ContactScheduler::PredictPairs(const int id, const int skippedOther)
+{
+	if (GetState(id)->numImpacts >= settings.maxImpactsPerBody) return;
+
+	const float time_left = stepTime - currentTime;
+	if (time_left <= 0.0f) return;
+
+	const int local_index = islands->GetLocalIndex(id);
+	for (int p = pairOffsets[local_index]; p < pairOffsets[local_index + 1]; p++)
+	{
+		const int other = pairOthers[p];
+		if (other == skippedOther) continue;
+
+		const int id_a = std::min(id, other);
+		const int id_b = std::max(id, other);
+
+		// Both bodies are tested from the same time, which no earlier contact of the other body is left before
+		AdvanceBody(other, currentTime);
+
+		const ConstBody a = (*bodies)[id_a];
+		const ConstBody b = (*bodies)[id_b];
+		if (a.inverseMass == 0.0f && b.inverseMass == 0.0f) continue;
+
+		Contact contact;
+		if (!Intersections::Intersect(a, b, time_left, contact)) continue;
+
+		// A pair tested again right after an impact still touches, it only collides again if it keeps closing in
+		const Vec3 ra = contact.ptOnAWorldSpace - a.GetCenterOfMassWorldSpace();
+		const Vec3 rb = contact.ptOnBWorldSpace - b.GetCenterOfMassWorldSpace();
+		const Vec3 vel_a = a.linearVelocity + a.angularVelocity.Cross(ra);
+		const Vec3 vel_b = b.linearVelocity + b.angularVelocity.Cross(rb);
+		if ((vel_a - vel_b).Dot(contact.normal) >= 0.0f) continue;
+
+		contact.timeOfImpact += currentTime;
+		contact.idA = id_a;
+		contact.idB = id_b;
+		predictedContacts.push_back(contact);
+		Schedule(numIslandContacts + (int)predictedContacts.size() - 1);
+	}
+}
+
+void ContactScheduler::ResolvePenetrations(const int* islandBodies, const int numBodies)
+{
+	const float inverse_dt = 1.0f / stepTime;
+
+	// The points follow the bodies, the depth left at the end of the step is the one corrected
+	penetrations.clear();
+	for (const int index : overlappingContacts)
+	{
+		const Contact& contact = GetContact(index);
+		const ConstBody a = (*bodies)[contact.idA];
+		const ConstBody b = (*bodies)[contact.idB];
+
+		const Vec3 pt_on_a = a.BodySpaceToWorldSpace(contact.ptOnALocalSpace);
+		const Vec3 pt_on_b = b.BodySpaceToWorldSpace(contact.ptOnBLocalSpace);
+		const Vec3& n = contact.normal;
+		const float depth = (pt_on_b - pt_on_a).Dot(n);
+		if (depth <= settings.allowedPenetration) continue;
+
+		Penetration penetration;
+		penetration.idA = contact.idA;
+		penetration.idB = contact.idB;
+		penetration.normal = n;
+		penetration.ra = pt_on_a - a.GetCenterOfMassWorldSpace();
+		penetration.rb = pt_on_b - b.GetCenterOfMassWorldSpace();
+		penetration.targetSpeed = settings.penetrationBias * (depth - settings.allowedPenetration) * inverse_dt;
+		penetration.impulse = 0.0f;
+
+		const Vec3 angular_ja = a.ApplyInverseInertiaWorldSpace(penetration.ra.Cross(n)).Cross(penetration.ra);
+		const Vec3 angular_jb = b.ApplyInverseInertiaWorldSpace(penetration.rb.Cross(n)).Cross(penetration.rb);
+		const float inverse_effective_mass = a.inverseMass + b.inverseMass + (angular_ja + angular_jb).Dot(n);
+		penetration.effectiveMass = inverse_effective_mass > 0.0f ? 1.0f / inverse_effective_mass : 0.0f;
+		penetrations.push_back(penetration);
+	}
+
+	// Pseudo velocities of the bodies are solved together, so neighbouring contacts don't push each other back in
+	for (int iter = 0; iter < settings.penetrationIterations; iter++)
+	{
+		for (Penetration& penetration : penetrations)
+		{
+			const ConstBody a = (*bodies)[penetration.idA];
+			const ConstBody b = (*bodies)[penetration.idB];
+			BodyState* state_a = GetState(penetration.idA);
+			BodyState* state_b = GetState(penetration.idB);
+			const Vec3& n = penetration.normal;
+
+			Vec3 vel_a;
+			Vec3 vel_b;
+			if (state_a) vel_a = state_a->pseudoLinearVelocity + state_a->pseudoAngularVelocity.Cross(penetration.ra);
+			if (state_b) vel_b = state_b->pseudoLinearVelocity + state_b->pseudoAngularVelocity.Cross(penetration.rb);
+
+			// Only pushes, the impulse accumulated over the iterations stays positive
+			const float delta = (penetration.targetSpeed - (vel_a - vel_b).Dot(n)) * penetration.effectiveMass;
+			const float old_impulse = penetration.impulse;
+			penetration.impulse = std::max(old_impulse + delta, 0.0f);
+			const Vec3 impulse = n * (penetration.impulse - old_impulse);
+
+			if (state_a)
+			{
+				state_a->pseudoLinearVelocity += impulse * a.inverseMass;
+				state_a->pseudoAngularVelocity += a.ApplyInverseInertiaWorldSpace(penetration.ra.Cross(impulse));
+			}
+			if (state_b)
+			{
+				state_b->pseudoLinearVelocity -= impulse * b.inverseMass;
+				state_b->pseudoAngularVelocity -= b.ApplyInverseInertiaWorldSpace(penetration.rb.Cross(impulse));
+			}
+		}
+	}
+
+	// The pseudo velocities move the bodies over the step, then they are dropped
+	for (int i = 0; i < numBodies; i++)
+	{
+		BodyState* state = GetState(islandBodies[i]);
+		(*bodies)[islandBodies[i]].Displace(state->pseudoLinearVelocity * stepTime, state->pseudoAngularVelocity * stepTime);
+		state->pseudoLinearVelocity.Zero();
+		state->pseudoAngularVelocity.Zero();
+	}
+}
@@ -0,0 +1,139 @@
+#pragma once
+#include <vector>
+#include "BodyStore.h"
+#include "Contact.h"
+#include "Broadphase.h"
+#include "PairCache.h"
+
+class Islands;
+
+
+// Tuning of the time of impact resolver
+struct ContactSchedulerSettings
+{
+	// Contacts resolved by a body after which its pairs are not tested again during the step
+	int maxImpactsPerBody{ 8 };
+
+	// How the bodies found overlapping at the start of the step are pulled apart
+	PenetrationCorrection penetrationCorrection{ PenetrationCorrection::SNAP };
+	// Split impulse: iterations of the pseudo velocity pass
+	int penetrationIterations{ 4 };
+	// Split impulse: part of the penetration removed by every step
+	float penetrationBias{ 0.2f };
+	// Split impulse: penetration left alone, so resting contacts don't come and go from one step to the next
+	float allowedPenetration{ 0.005f };
+};
+
+/// <summary>
+/// Resolves the contacts of an island in time of impact order, from a priority queue.
+/// Every body has its own local time and is only moved up to the time it is needed at, so a contact costs the two bodies
+/// it touches instead of the whole scene. After a contact is resolved, only the pairs of these two bodies are tested again,
+/// and the contacts predicted with their old velocities are dropped when they come out of the queue.
+/// Bodies overlapping at the start of the step are either snapped apart by their contact, or pushed apart at the end of
+/// the step by pseudo velocities: a separate pass solves them over all the overlapping contacts of the island, and they
+/// only move the bodies, so the correction adds no energy.
+/// </summary>
+class ContactScheduler
+{
+public:
+	/// <summary>
+	/// Resolves the contacts of an island found by the narrow phase over dt_sec, then moves its bodies to the end of the step.
+	/// The pairs tested again after a contact are the ones of the island. Bodies with an infinite mass are only read.
+	/// </summary>
+	void Resolve(BodyStore& bodies, const Islands& islands, const int island,
+		const std::vector<Contact>& contacts, PairCache& pairCache, const float dt_sec);
+
+	// Forgets the contacts of the last step (call it when the body list is replaced)
+	void Clear();
+
+	ContactSchedulerSettings settings;
+
+	// Number of contacts resolved by the last island
+	int GetNumResolved() const { return numResolved; }
+
+private:
+	// Key of a contact in the queue, the contacts themselves are never moved
+	struct Event
+	{
+		float timeOfImpact;
+		// See GetContact
+		int contact;
+		// Versions of the bodies when the contact was predicted
+		unsigned int versionA;
+		unsigned int versionB;
+
+		// Earliest first, ties in the order the contacts were found
+		bool operator>(const Event& rhs) const
+		{
+			if (timeOfImpact != rhs.timeOfImpact) return timeOfImpact > rhs.timeOfImpact;
+			return contact > rhs.contact;
+		}
+	};
+
+	// Split impulse: an overlapping contact as seen at the end of the step
+	struct Penetration
+	{
+		int idA;
+		int idB;
+		Vec3 normal;
+		Vec3 ra;
+		Vec3 rb;
+		float targetSpeed;
+		float effectiveMass;
+		// Pseudo impulse accumulated over the iterations
+		float impulse;
+	};
+
+	struct BodyState
+	{
+		float localTime{ 0.0f };
+		// Increased every time a contact changes the velocities of the body
+		unsigned int version{ 0 };
+		int numImpacts{ 0 };
+
+		// Split impulse: velocities only moving the body out of the ones it overlaps
+		Vec3 pseudoLinearVelocity;
+		Vec3 pseudoAngularVelocity;
+	};
+
+	// State of a body of the island, nullptr for the bodies with an infinite mass
+	BodyState* GetState(const int id);
+	unsigned int GetVersion(const int id) const;
+
+	// Island contacts of the narrow phase first, in the order of the island, then the contacts predicted during the step
+	const Contact& GetContact(const int index) const;
+	void Schedule(const int index);
+	void AdvanceBody(const int id, const float time);
+	bool IsStale(const Event& event) const;
+	// Invalidates the contacts predicted with the previous velocities of the body
+	void OnImpact(const int id);
+
+	// Tests again the pairs of a body from the current time, except the one with skippedOther
+	void PredictPairs(const int id, const int skippedOther);
+
+	// Split impulse: solves the pseudo velocities of the overlapping contacts, then moves the bodies of the island with them
+	void ResolvePenetrations(const int* islandBodies, const int numBodies);
+
+	BodyStore* bodies{ nullptr };
+	const Islands* islands{ nullptr };
+	float stepTime{ 0.0f };
+	float currentTime{ 0.0f };
+	int numResolved{ 0 };
+
+	// Indexed by the local index of the bodies in the island
+	std::vector<BodyState> bodyStates;
+	const std::vector<Contact>* foundContacts{ nullptr };
+	const int* islandContacts{ nullptr };
+	int numIslandContacts{ 0 };
+	std::vector<Contact> predictedContacts;
+	// Split impulse: contacts of the bodies overlapping at the start of the step
+	std::vector<int> overlappingContacts;
+	std::vector<Penetration> penetrations;
+	// Min-heap of events, kept with std::push_heap and std::pop_heap
+	std::vector<Event> queue;
+
+	// Other bodies of the pairs of the body of local index i are pairOthers[pairOffsets[i]] to pairOthers[pairOffsets[i + 1] - 1]
+	std::vector<int> pairOffsets;
+	std::vector<int> pairOthers;
+	std::vector<int> pairFill;
+};
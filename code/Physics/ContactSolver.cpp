@@ -0,0 +1,298 @@
+#include "ContactSolver.h"
+#include "Islands.h"
+#include "Intersections.h"
+#include <algorithm>
+#include <float.h>
+
+
+void ContactSolver::Solve(BodyStore& bodies, const Islands& islands, const int island,
+	const std::vector<Contact>& contacts, PairCache& pairCache, FrameArena& frameArena, const float dt_sec)
+{
+	const Island& current_island = islands.GetIsland(island);
+	UpdateManifolds(bodies, islands, current_island, contacts, pairCache);
+
+	const int* island_bodies = islands.GetBodies().data() + current_island.firstBody;
+	solverBodies.clear();
+	for (int i = 0; i < current_island.numBodies; i++)
+	{
+		AddSolverBody(bodies, island_bodies[i], i);
+	}
+
+	rows.clear();
+	positionRows.clear();
+	points.clear();
+	const CollisionPair* pairs = islands.GetPairs().data() + current_island.firstPair;
+	for (int p = 0; p < current_island.numPairs; p++)
+	{
+		CachedPair* cached_pair = pairCache.Find(pairs[p].a, pairs[p].b);
+		if (!cached_pair || cached_pair->manifold.numPoints == 0) continue;
+
+		const ConstBody a = bodies[cached_pair->a];
+		const ConstBody b = bodies[cached_pair->b];
+		if (a.inverseMass == 0.0f && b.inverseMass == 0.0f) continue;
+
+		const int slot_a = AddSolverBody(bodies, cached_pair->a, islands.GetLocalIndex(cached_pair->a));
+		const int slot_b = AddSolverBody(bodies, cached_pair->b, islands.GetLocalIndex(cached_pair->b));
+
+		ContactManifold& manifold = cached_pair->manifold;
+		bool warm = false;
+		for (int i = 0; i < manifold.numPoints; i++)
+		{
+			warm = warm || manifold.points[i].normalImpulse != 0.0f;
+		}
+
+		const int first_row = (int)rows.size();
+		for (int i = 0; i < manifold.numPoints; i++)
+		{
+			AddPointRows(a, slot_a, b, slot_b, manifold.points[i], dt_sec);
+		}
+
+		if (settings.blockWarmStart && !warm && manifold.numPoints > 1)
+		{
+			WarmStartNormals(first_row, manifold.numPoints, frameArena);
+		}
+	}
+
+	if (settings.coloredBatches)
+	{
+		LCP_ColorConstraints(solverBodies, rows, coloring);
+		numIterations = LCP_SparseGaussSeidelColored(solverBodies, rows, coloring, settings.velocityIterations, settings.impulseTolerance);
+	}
+	else
+	{
+		numIterations = LCP_SparseGaussSeidel(solverBodies, rows, settings.velocityIterations, settings.impulseTolerance);
+	}
+
+	// Impulses are kept by the points for the next step, and by the pairs like the ones of the time of impact resolver
+	for (int i = 0; i < (int)points.size(); i++)
+	{
+		points[i]->tangentImpulse[0] = rows[i * 3].lambda;
+		points[i]->tangentImpulse[1] = rows[i * 3 + 1].lambda;
+		points[i]->normalImpulse = rows[i * 3 + 2].lambda;
+	}
+	for (int p = 0; p < current_island.numPairs; p++)
+	{
+		CachedPair* cached_pair = pairCache.Find(pairs[p].a, pairs[p].b);
+		if (!cached_pair) continue;
+
+		float normal_impulse = 0.0f;
+		for (int i = 0; i < cached_pair->manifold.numPoints; i++)
+		{
+			normal_impulse += cached_pair->manifold.points[i].normalImpulse;
+		}
+		cached_pair->normalImpulse = normal_impulse;
+	}
+
+	// Pseudo velocities start from zero on every step, only the bodies moved by them are kept
+	if (!positionRows.empty())
+	{
+		pseudoBodies = solverBodies;
+		for (LCP_Body& pseudo_body : pseudoBodies)
+		{
+			pseudo_body.linearVelocity.Zero();
+			pseudo_body.angularVelocity.Zero();
+		}
+		LCP_SparseGaussSeidel(pseudoBodies, positionRows, settings.positionIterations, settings.impulseTolerance);
+	}
+
+	for (int i = 0; i < current_island.numBodies; i++)
+	{
+		Body body = bodies[island_bodies[i]];
+		body.SetVelocities(solverBodies[i].linearVelocity, solverBodies[i].angularVelocity);
+		body.Update(dt_sec);
+
+		if (!positionRows.empty())
+		{
+			body.Displace(pseudoBodies[i].linearVelocity * dt_sec, pseudoBodies[i].angularVelocity * dt_sec);
+		}
+	}
+}
+
+void ContactSolver::WarmStartNormals(const int firstRow, const int numPoints, FrameArena& frameArena)
+{
+	// Every point has its normal row last of its three, all of them between the same two bodies
+	const LCP_Row& first = rows[firstRow + 2];
+	const LCP_Body& body_a = solverBodies[first.bodyA];
+	const LCP_Body& body_b = solverBodies[first.bodyB];
+
+	MatN A(numPoints, frameArena);
+	VecN b(numPoints, frameArena);
+	for (int i = 0; i < numPoints; i++)
+	{
+		const LCP_Row& row_i = rows[firstRow + i * 3 + 2];
+		const float velocity = row_i.linearA.Dot(body_a.linearVelocity) + row_i.angularA.Dot(body_a.angularVelocity)
+			+ row_i.linearB.Dot(body_b.linearVelocity) + row_i.angularB.Dot(body_b.angularVelocity);
+		b[i] = row_i.rhs - velocity;
+
+		// A = J * M^-1 * J^T, how an impulse on the row j changes the velocity of the row i
+		for (int j = 0; j < numPoints; j++)
+		{
+			const LCP_Row& row_j = rows[firstRow + j * 3 + 2];
+			A.rows[i][j] = row_i.linearA.Dot(row_j.linearA) * body_a.inverseMass + row_i.angularA.Dot(body_a.inverseInertia * row_j.angularA)
+				+ row_i.linearB.Dot(row_j.linearB) * body_b.inverseMass + row_i.angularB.Dot(body_b.inverseInertia * row_j.angularB);
+		}
+	}
+
+	// Rows only push, the iterations correct whatever clamping the solution leaves
+	const VecN lambda = LCP_GaussSeidel(A, b, frameArena);
+	for (int i = 0; i < numPoints; i++)
+	{
+		rows[firstRow + i * 3 + 2].lambda = std::max(lambda[i], 0.0f);
+	}
+}
+
+void ContactSolver::Clear()
+{
+	rows.clear();
+	points.clear();
+}
+
+void ContactSolver::UpdateManifolds(const BodyStore& bodies, const Islands& islands, const Island& island,
+	const std::vector<Contact>& contacts, PairCache& pairCache) const
+{
+	// Points of the last steps follow the bodies, the ones they moved away from are dropped
+	const CollisionPair* pairs = islands.GetPairs().data() + island.firstPair;
+	for (int p = 0; p < island.numPairs; p++)
+	{
+		CachedPair* cached_pair = pairCache.Find(pairs[p].a, pairs[p].b);
+		if (!cached_pair) continue;
+
+		cached_pair->manifold.Refresh(bodies[cached_pair->a], bodies[cached_pair->b]);
+	}
+
+	// Manifolds are stored for the lowest body first, contacts found the other way around are flipped
+	const int* island_contacts = islands.GetContacts().data() + island.firstContact;
+	for (int c = 0; c < island.numContacts; c++)
+	{
+		const Contact& contact = contacts[island_contacts[c]];
+		CachedPair* cached_pair = pairCache.Find(contact.idA, contact.idB);
+		if (!cached_pair) continue;
+
+		Contact oriented = contact;
+		if (contact.idA != cached_pair->a)
+		{
+			oriented.ptOnAWorldSpace = contact.ptOnBWorldSpace;
+			oriented.ptOnBWorldSpace = contact.ptOnAWorldSpace;
+			oriented.ptOnALocalSpace = contact.ptOnBLocalSpace;
+			oriented.ptOnBLocalSpace = contact.ptOnALocalSpace;
+			oriented.normal = contact.normal * -1.0f;
+		}
+
+		ContactManifold& manifold = cached_pair->manifold;
+		manifold.AddContact(oriented);
+
+		// Bodies touching now get the rest of their points at once, rather than over the next steps as they rock
+		if (oriented.timeOfImpact > 0.0f || manifold.numPoints >= ContactManifold::maxPoints) continue;
+
+		Contact perturbed_contacts[ContactManifold::maxPoints];
+		const int num_perturbed = Intersections::FindPerturbedContacts(bodies[cached_pair->a], bodies[cached_pair->b],
+			oriented, perturbed_contacts, ContactManifold::maxPoints);
+		for (int i = 0; i < num_perturbed; i++)
+		{
+			manifold.AddContact(perturbed_contacts[i]);
+		}
+	}
+}
+
+int ContactSolver::AddSolverBody(const BodyStore& bodies, const int id, const int localIndex)
+{
+	if (localIndex >= 0 && localIndex < (int)solverBodies.size()) return localIndex;
+
+	LCP_Body solver_body;
+	solver_body.linearVelocity = bodies.linearVelocities[id];
+	solver_body.angularVelocity = bodies.angularVelocities[id];
+	solver_body.inverseMass = bodies.inverseMasses[id];
+	solver_body.maxAngularSpeed = Body::maxAngularSpeed;
+
+	// Bodies with an infinite mass are shared by islands, their inertia cache isn't touched
+	if (solver_body.inverseMass == 0.0f)
+	{
+		solver_body.inverseInertia.Zero();
+	}
+	else
+	{
+		solver_body.inverseInertia = bodies[id].GetInverseInertiaTensorWorldSpace();
+	}
+
+	solverBodies.push_back(solver_body);
+	return (int)solverBodies.size() - 1;
+}
+
+void ContactSolver::AddPointRows(const ConstBody& a, const int slotA, const ConstBody& b, const int slotB, ManifoldPoint& point, const float dt_sec)
+{
+	const Vec3 pt_on_a = a.BodySpaceToWorldSpace(point.ptOnALocalSpace);
+	const Vec3 pt_on_b = b.BodySpaceToWorldSpace(point.ptOnBLocalSpace);
+	const Vec3 ra = pt_on_a - a.GetCenterOfMassWorldSpace();
+	const Vec3 rb = pt_on_b - b.GetCenterOfMassWorldSpace();
+	const Vec3& normal = point.normal;
+	Vec3 tangents[2];
+	normal.GetOrtho(tangents[0], tangents[1]);
+
+	// Relative velocity of A against B along the direction, the impulse pushing A along it and B the other way
+	auto make_row = [&](const Vec3& direction, const float rhs, const float lambda)
+	{
+		LCP_Row row;
+		row.bodyA = slotA;
+		row.bodyB = slotB;
+		row.linearA = direction;
+		row.angularA = ra.Cross(direction);
+		row.linearB = direction * -1.0f;
+		row.angularB = rb.Cross(direction) * -1.0f;
+		row.rhs = rhs;
+		row.lower = 0.0f;
+		row.upper = FLT_MAX;
+		row.normalRow = -1;
+		row.friction = 0.0f;
+		row.lambda = lambda;
+		return row;
+	};
+
+	const Vec3 vel_a = a.linearVelocity + a.angularVelocity.Cross(ra);
+	const Vec3 vel_b = b.linearVelocity + b.angularVelocity.Cross(rb);
+	const float separation = (pt_on_a - pt_on_b).Dot(normal);
+	const float closing_speed = (vel_b - vel_a).Dot(normal);
+	const float elasticity = a.elasticity * b.elasticity;
+
+	// Lowest relative normal speed the contact allows
+	float target_speed;
+	if (separation > 0.0f)
+	{
+		// Speculative point, the bodies can close the gap during the step but no more
+		target_speed = -separation / dt_sec;
+	}
+	else
+	{
+		// Overlapping bodies are pushed apart a bit on every step, by the pseudo velocities or by the velocities themselves
+		const float push_speed = settings.baumgarteFactor * std::max(-separation - settings.allowedPenetration, 0.0f) / dt_sec;
+		if (settings.splitImpulse)
+		{
+			target_speed = 0.0f;
+			if (push_speed > 0.0f)
+			{
+				positionRows.push_back(make_row(normal, push_speed, 0.0f));
+			}
+		}
+		else
+		{
+			target_speed = push_speed;
+		}
+	}
+
+	// Bodies hitting each other during the step bounce
+	if (closing_speed > settings.restitutionThreshold && closing_speed * dt_sec > separation)
+	{
+		target_speed = std::max(target_speed, elasticity * closing_speed);
+	}
+
+	// Friction rows first, bounded by the normal impulse of the last iteration
+	const int normal_row = (int)rows.size() + 2;
+	for (int k = 0; k < 2; k++)
+	{
+		rows.push_back(make_row(tangents[k], 0.0f, point.tangentImpulse[k]));
+		rows.back().normalRow = normal_row;
+		rows.back().friction = a.friction * b.friction;
+	}
+	rows.push_back(make_row(normal, target_speed, point.normalImpulse));
+
+	points.push_back(&point);
+}
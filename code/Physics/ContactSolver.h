@@ -0,0 +1,90 @@
+#pragma once
+#include <vector>
+#include "BodyStore.h"
+#include "Contact.h"
+#include "Broadphase.h"
+#include "PairCache.h"
+#include "../Math/LCP.h"
+
+class Islands;
+struct Island;
+
+
+// Tuning of the sequential impulse solver
+struct ContactSolverSettings
+{
+	int velocityIterations{ 8 };
+	// Iterations stop early once no impulse changes by more than this
+	float impulseTolerance{ 0.0001f };
+	// Part of the penetration removed by every step
+	float baumgarteFactor{ 0.2f };
+	// Penetration is removed by pseudo velocities solved apart, which move the bodies without adding to their velocities.
+	// Otherwise the velocity rows push the bodies apart themselves, and the energy they add stays.
+	bool splitImpulse{ true };
+	int positionIterations{ 4 };
+	// Penetration left alone, so resting contacts don't come and go from one step to the next
+	float allowedPenetration{ 0.005f };
+	// Closing speed under which contacts don't bounce
+	float restitutionThreshold{ 2.0f };
+	// Manifolds are colored so the ones not sharing bodies are solved four at a time with SSE
+	bool coloredBatches{ true };
+	// Manifolds without impulses from the last step start from their normal rows solved together as one dense system,
+	// so the points of a box landing flat share its weight from the first iteration
+	bool blockWarmStart{ true };
+};
+
+
+/// <summary>
+/// Resolves the contacts of an island with sequential impulses over the contact manifolds of its pairs.
+/// Every point of a manifold is a constraint keeping the bodies from closing in along the normal, with friction along
+/// two tangents. The constraints are rows of LCP_SparseGaussSeidel: they are solved one after the other for a number of
+/// iterations, each one clamping the impulse it accumulated rather than the last change, and they start from the impulses
+/// of the last step kept by the manifolds.
+/// Points still apart are speculative: the bodies may close the gap, but not more, so fast bodies don't tunnel.
+/// Overlapping points are pushed apart by a second solve over pseudo velocities, that only move the bodies (split impulse).
+/// </summary>
+class ContactSolver
+{
+public:
+	/// <summary>
+	/// Adds the contacts of an island found by the narrow phase to the manifolds of its pairs, solves the velocities
+	/// of its bodies, then moves them to the end of the step. Bodies with an infinite mass are only read.
+	/// The dense systems of the block warm start are allocated in frameArena.
+	/// </summary>
+	void Solve(BodyStore& bodies, const Islands& islands, const int island,
+		const std::vector<Contact>& contacts, PairCache& pairCache, FrameArena& frameArena, const float dt_sec);
+
+	void Clear();
+
+	ContactSolverSettings settings;
+
+	// Number of contact points solved by the last island
+	int GetNumPoints() const { return (int)points.size(); }
+	// Iterations the last island needed
+	int GetNumIterations() const { return numIterations; }
+
+private:
+	void UpdateManifolds(const BodyStore& bodies, const Islands& islands, const Island& island,
+		const std::vector<Contact>& contacts, PairCache& pairCache) const;
+
+	// Index of the body of this scene index in solverBodies, bodies with an infinite mass get a new one every time
+	int AddSolverBody(const BodyStore& bodies, const int id, const int localIndex);
+
+	// Adds the rows of a point, the two tangents first, then the normal bounding them
+	void AddPointRows(const ConstBody& a, const int slotA, const ConstBody& b, const int slotB, ManifoldPoint& point, const float dt_sec);
+
+	// Starts the normal rows of the numPoints points from firstRow on from the solution of A * lambda = rhs - J * v
+	void WarmStartNormals(const int firstRow, const int numPoints, FrameArena& frameArena);
+
+	// Island bodies first, in the order of the island, then one per pair for the bodies with an infinite mass
+	std::vector<LCP_Body> solverBodies;
+	std::vector<LCP_Row> rows;
+	// Split impulse: same bodies with their pseudo velocities, and a row for every overlapping point
+	std::vector<LCP_Body> pseudoBodies;
+	std::vector<LCP_Row> positionRows;
+	// Point of every group of three rows
+	std::vector<ManifoldPoint*> points;
+	// Colors of the manifolds, and the rows of the manifolds solved together
+	LCP_Coloring coloring;
+	int numIterations{ 0 };
+};
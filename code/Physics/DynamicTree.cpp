@@ -0,0 +1,401 @@
+#include "DynamicTree.h"
+#include <algorithm>
+
+
+static Bounds UnionBounds(const Bounds& a, const Bounds& b)
+{
+	Bounds temp = a;
+	temp.Expand(b);
+	return temp;
+}
+
+// Surface area without the factor 2, only used to compare insertion costs
+static float HalfSurfaceArea(const Bounds& bounds)
+{
+	const float dx = bounds.WidthX();
+	const float dy = bounds.WidthY();
+	const float dz = bounds.WidthZ();
+	return dx * dy + dy * dz + dz * dx;
+}
+
+static bool ContainsBounds(const Bounds& outer, const Bounds& inner)
+{
+	return outer.mins.x <= inner.mins.x && outer.mins.y <= inner.mins.y && outer.mins.z <= inner.mins.z
+		&& inner.maxs.x <= outer.maxs.x && inner.maxs.y <= outer.maxs.y && inner.maxs.z <= outer.maxs.z;
+}
+
+
+//=====================================
+// ========= DYNAMIC AABB TREE ========
+//=====================================
+
+int DynamicAABBTree::CreateProxy(const Bounds& bounds, const int userId)
+{
+	const int proxy = AllocateNode();
+
+	TreeNode& node = nodes[proxy];
+	node.bounds = bounds;
+	node.bounds.Expand(bounds.mins - Vec3(fatMargin));
+	node.bounds.Expand(bounds.maxs + Vec3(fatMargin));
+	node.userId = userId;
+	node.height = 0;
+
+	InsertLeaf(proxy);
+	return proxy;
+}
+
+void DynamicAABBTree::DestroyProxy(const int proxy)
+{
+	RemoveLeaf(proxy);
+	FreeNode(proxy);
+}
+
+bool DynamicAABBTree::MoveProxy(const int proxy, const Bounds& bounds)
+{
+	if (ContainsBounds(nodes[proxy].bounds, bounds)) return false;
+
+	RemoveLeaf(proxy);
+
+	TreeNode& node = nodes[proxy];
+	node.bounds = bounds;
+	node.bounds.Expand(bounds.mins - Vec3(fatMargin));
+	node.bounds.Expand(bounds.maxs + Vec3(fatMargin));
+
+	InsertLeaf(proxy);
+	return true;
+}
+
+void DynamicAABBTree::Clear()
+{
+	nodes.clear();
+	root = nullNode;
+	freeList = nullNode;
+}
+
+int DynamicAABBTree::AllocateNode()
+{
+	int node = freeList;
+	if (node != nullNode)
+	{
+		// Free nodes are chained through their parent index
+		freeList = nodes[node].parent;
+	}
+	else
+	{
+		node = (int)nodes.size();
+		nodes.push_back(TreeNode());
+	}
+
+	nodes[node].parent = nullNode;
+	nodes[node].left = nullNode;
+	nodes[node].right = nullNode;
+	nodes[node].height = 0;
+	nodes[node].userId = -1;
+	return node;
+}
+
+void DynamicAABBTree::FreeNode(const int node)
+{
+	nodes[node].parent = freeList;
+	nodes[node].height = -1;
+	freeList = node;
+}
+
+void DynamicAABBTree::InsertLeaf(const int leaf)
+{
+	if (root == nullNode)
+	{
+		root = leaf;
+		nodes[root].parent = nullNode;
+		return;
+	}
+
+	// Find the best sibling for the leaf, descending where the surface area grows the least
+	const Bounds leaf_bounds = nodes[leaf].bounds;
+	int index = root;
+	while (!nodes[index].IsLeaf())
+	{
+		const TreeNode& node = nodes[index];
+
+		const float area = HalfSurfaceArea(node.bounds);
+		const float combined_area = HalfSurfaceArea(UnionBounds(node.bounds, leaf_bounds));
+
+		// Cost of making a new parent for this node and the leaf
+		const float cost = 2.0f * combined_area;
+
+		// Minimum cost of pushing the leaf further down the tree
+		const float inheritance_cost = 2.0f * (combined_area - area);
+
+		float child_costs[2];
+		const int children[2] = { node.left, node.right };
+		for (int i = 0; i < 2; i++)
+		{
+			const TreeNode& child = nodes[children[i]];
+			const float child_area = HalfSurfaceArea(UnionBounds(child.bounds, leaf_bounds));
+			child_costs[i] = child.IsLeaf() ? child_area + inheritance_cost : child_area - HalfSurfaceArea(child.bounds) + inheritance_cost;
+		}
+
+		if (cost < child_costs[0] && cost < child_costs[1]) break;
+
+		index = child_costs[0] < child_costs[1] ? children[0] : children[1];
+	}
+
+	const int sibling = index;
+
+	// Create a new parent for the sibling and the leaf
+	const int old_parent = nodes[sibling].parent;
+	const int new_parent = AllocateNode();
+	nodes[new_parent].parent = old_parent;
+	nodes[new_parent].bounds = UnionBounds(leaf_bounds, nodes[sibling].bounds);
+	nodes[new_parent].height = nodes[sibling].height + 1;
+	nodes[new_parent].left = sibling;
+	nodes[new_parent].right = leaf;
+	nodes[sibling].parent = new_parent;
+	nodes[leaf].parent = new_parent;
+
+	if (old_parent != nullNode)
+	{
+		ReplaceChild(old_parent, sibling, new_parent);
+	}
+	else
+	{
+		root = new_parent;
+	}
+
+	// Walk back up the tree fixing heights and bounds
+	index = nodes[leaf].parent;
+	while (index != nullNode)
+	{
+		index = Balance(index);
+
+		TreeNode& node = nodes[index];
+		node.height = 1 + std::max(nodes[node.left].height, nodes[node.right].height);
+		node.bounds = UnionBounds(nodes[node.left].bounds, nodes[node.right].bounds);
+
+		index = node.parent;
+	}
+}
+
+void DynamicAABBTree::RemoveLeaf(const int leaf)
+{
+	if (leaf == root)
+	{
+		root = nullNode;
+		return;
+	}
+
+	const int parent = nodes[leaf].parent;
+	const int grand_parent = nodes[parent].parent;
+	const int sibling = nodes[parent].left == leaf ? nodes[parent].right : nodes[parent].left;
+
+	if (grand_parent == nullNode)
+	{
+		root = sibling;
+		nodes[sibling].parent = nullNode;
+		FreeNode(parent);
+		return;
+	}
+
+	// Destroy the parent and connect the sibling to the grand parent
+	ReplaceChild(grand_parent, parent, sibling);
+	nodes[sibling].parent = grand_parent;
+	FreeNode(parent);
+
+	int index = grand_parent;
+	while (index != nullNode)
+	{
+		index = Balance(index);
+
+		TreeNode& node = nodes[index];
+		node.height = 1 + std::max(nodes[node.left].height, nodes[node.right].height);
+		node.bounds = UnionBounds(nodes[node.left].bounds, nodes[node.right].bounds);
+
+		index = node.parent;
+	}
+}
+
+void DynamicAABBTree::ReplaceChild(const int parent, const int oldChild, const int newChild)
+{
+	if (nodes[parent].left == oldChild)
+	{
+		nodes[parent].left = newChild;
+	}
+	else
+	{
+		nodes[parent].right = newChild;
+	}
+}
+
+int DynamicAABBTree::Balance(const int a)
+{
+	// Rotates the taller child up when the two subtrees of a differ by more than one level.
+	// Returns the new root of the subtree.
+	if (nodes[a].IsLeaf() || nodes[a].height < 2) return a;
+
+	const int b = nodes[a].left;
+	const int c = nodes[a].right;
+	const int balance = nodes[c].height - nodes[b].height;
+
+	// Rotate c up
+	if (balance > 1)
+	{
+		const int f = nodes[c].left;
+		const int g = nodes[c].right;
+
+		nodes[c].left = a;
+		nodes[c].parent = nodes[a].parent;
+		nodes[a].parent = c;
+
+		if (nodes[c].parent != nullNode)
+		{
+			ReplaceChild(nodes[c].parent, a, c);
+		}
+		else
+		{
+			root = c;
+		}
+
+		// The tallest grand child stays under c, the other one goes under a
+		const int kept = nodes[f].height > nodes[g].height ? f : g;
+		const int moved = kept == f ? g : f;
+
+		nodes[c].right = kept;
+		nodes[a].right = moved;
+		nodes[moved].parent = a;
+
+		nodes[a].bounds = UnionBounds(nodes[b].bounds, nodes[moved].bounds);
+		nodes[c].bounds = UnionBounds(nodes[a].bounds, nodes[kept].bounds);
+		nodes[a].height = 1 + std::max(nodes[b].height, nodes[moved].height);
+		nodes[c].height = 1 + std::max(nodes[a].height, nodes[kept].height);
+
+		return c;
+	}
+
+	// Rotate b up
+	if (balance < -1)
+	{
+		const int d = nodes[b].left;
+		const int e = nodes[b].right;
+
+		nodes[b].left = a;
+		nodes[b].parent = nodes[a].parent;
+		nodes[a].parent = b;
+
+		if (nodes[b].parent != nullNode)
+		{
+			ReplaceChild(nodes[b].parent, a, b);
+		}
+		else
+		{
+			root = b;
+		}
+
+		const int kept = nodes[d].height > nodes[e].height ? d : e;
+		const int moved = kept == d ? e : d;
+
+		nodes[b].right = kept;
+		nodes[a].left = moved;
+		nodes[moved].parent = a;
+
+		nodes[a].bounds = UnionBounds(nodes[c].bounds, nodes[moved].bounds);
+		nodes[b].bounds = UnionBounds(nodes[a].bounds, nodes[kept].bounds);
+		nodes[a].height = 1 + std::max(nodes[c].height, nodes[moved].height);
+		nodes[b].height = 1 + std::max(nodes[a].height, nodes[kept].height);
+
+		return b;
+	}
+
+	return a;
+}
+
+
+//=====================================
+// ======== TREE BROADPHASE ==========
+//=====================================
+
+void TreeBroadPhase::Update(const std::vector<Bounds>& bodiesBounds, std::vector<CollisionPair>& finalPairs)
+{
+	const size_t num = bodiesBounds.size();
+
+	finalPairs.clear();
+	stats.numSweptPairs = 0;
+	stats.numRejectedPairs = 0;
+
+	// Bodies are only identified by their index in the scene, a removal shifts every id after it
+	if (num < proxies.size())
+	{
+		Clear();
+	}
+
+	for (size_t i = 0; i < num; i++)
+	{
+		if (i < proxies.size())
+		{
+			tree.MoveProxy(proxies[i], bodiesBounds[i]);
+		}
+		else
+		{
+			proxies.push_back(tree.CreateProxy(bodiesBounds[i], (int)i));
+		}
+	}
+
+	for (int i = 0; i < (int)num; i++)
+	{
+		const Bounds& bounds = bodiesBounds[i];
+		tree.Query(bounds, [&](const int j)
+		{
+			// Each pair is found from both of its bodies, only keep it once
+			if (j <= i) return;
+
+			// The query runs against the fat bounds, the swept bounds must overlap too
+			stats.numSweptPairs++;
+			if (!bounds.DoesIntersect(bodiesBounds[j]))
+			{
+				stats.numRejectedPairs++;
+				return;
+			}
+
+			finalPairs.push_back(CollisionPair{ i, j });
+		});
+	}
+}
+
+void TreeBroadPhase::Clear()
+{
+	tree.Clear();
+	proxies.clear();
+}
+
+
+//=====================================
+// ======= STATIC BROADPHASE =========
+//=====================================
+
+void StaticBroadPhase::Build(const BodyStore& bodies, const std::vector<int>& staticIds)
+{
+	Clear();
+
+	for (const int id : staticIds)
+	{
+		// Static bodies don't move, their bounds don't need to be swept
+		const int index = (int)bodiesBounds.size();
+		bodiesBounds.push_back(GetSweptBounds(bodies[id], 0.0f));
+		bodiesIds.push_back(id);
+		tree.CreateProxy(bodiesBounds[index], index);
+	}
+}
+
+void StaticBroadPhase::Clear()
+{
+	tree.Clear();
+	bodiesBounds.clear();
+	bodiesIds.clear();
+}
+
+void StaticBroadPhase::Query(const int id, const Bounds& bounds, std::vector<CollisionPair>& finalPairs) const
+{
+	tree.Query(bounds, [&](const int index)
+	{
+		finalPairs.push_back(CollisionPair{ id, bodiesIds[index] });
+	});
+}
@@ -0,0 +1,146 @@
+#pragma once
+#include <vector>
+#include <memory>
+#include "BodyStore.h"
+#include "Broadphase.h"
+#include "../Math/Bounds.h"
+
+
+/// <summary>
+/// Bounding volume hierarchy where each leaf holds a fattened AABB.
+/// A leaf is only reinserted when the bounds it is moved to leave its fat AABB,
+/// and tree rotations keep it balanced while leaves are inserted and removed.
+/// </summary>
+class DynamicAABBTree
+{
+public:
+	static const int nullNode = -1;
+
+	DynamicAABBTree(const float fatMarginP = 0.1f) : fatMargin(fatMarginP) {}
+
+	int CreateProxy(const Bounds& bounds, const int userId);
+	void DestroyProxy(const int proxy);
+
+	/// <summary>
+	/// Move a proxy to new bounds
+	/// </summary>
+	/// <returns>
+	/// True if the bounds left the fat AABB and the proxy was reinserted
+	/// </returns>
+	bool MoveProxy(const int proxy, const Bounds& bounds);
+
+	const Bounds& GetFatBounds(const int proxy) const { return nodes[proxy].bounds; }
+	int GetUserId(const int proxy) const { return nodes[proxy].userId; }
+	int GetHeight() const { return root == nullNode ? 0 : nodes[root].height; }
+
+	void Clear();
+
+	// Calls callback(userId) for every proxy whose fat AABB overlaps the bounds
+	template<typename Callback>
+	void Query(const Bounds& bounds, Callback callback) const;
+
+private:
+	struct TreeNode
+	{
+		Bounds bounds;
+		int parent;
+		int left;
+		int right;
+		int height;
+		int userId;
+
+		bool IsLeaf() const { return left == nullNode; }
+	};
+
+	int AllocateNode();
+	void FreeNode(const int node);
+
+	void InsertLeaf(const int leaf);
+	void RemoveLeaf(const int leaf);
+	void ReplaceChild(const int parent, const int oldChild, const int newChild);
+	int Balance(const int node);
+
+	std::vector<TreeNode> nodes;
+	int root{ nullNode };
+	int freeList{ nullNode };
+	float fatMargin;
+
+	mutable std::vector<int> queryStack;
+};
+
+template<typename Callback>
+void DynamicAABBTree::Query(const Bounds& bounds, Callback callback) const
+{
+	if (root == nullNode) return;
+
+	queryStack.clear();
+	queryStack.push_back(root);
+
+	while (!queryStack.empty())
+	{
+		const int index = queryStack.back();
+		queryStack.pop_back();
+
+		const TreeNode& node = nodes[index];
+		if (!node.bounds.DoesIntersect(bounds)) continue;
+
+		if (node.IsLeaf())
+		{
+			callback(node.userId);
+		}
+		else
+		{
+			queryStack.push_back(node.left);
+			queryStack.push_back(node.right);
+		}
+	}
+}
+
+
+/// <summary>
+/// Broadphase backend keeping one tree proxy per body.
+/// It handles a few huge bodies among many small ones much better than a 1D sweep.
+/// </summary>
+class TreeBroadPhase
+{
+public:
+	// Finds the overlapping pairs among the swept bounds of the bodies, one per body
+	void Update(const std::vector<Bounds>& bodiesBounds, std::vector<CollisionPair>& finalPairs);
+
+	// Forces a full rebuild on the next update (call it when the body list is replaced)
+	void Clear();
+
+	const BroadPhaseStats& GetStats() const { return stats; }
+	const DynamicAABBTree& GetTree() const { return tree; }
+
+private:
+	DynamicAABBTree tree;
+	std::vector<int> proxies;
+
+	BroadPhaseStats stats;
+};
+
+
+/// <summary>
+/// Holds the bodies with an infinite mass, which never move.
+/// The tree is built once and then only queried by the moving bodies, so static bodies are never swept
+/// and static against static pairs are never generated.
+/// </summary>
+class StaticBroadPhase
+{
+public:
+	StaticBroadPhase() : tree(0.0f) {}
+
+	void Build(const BodyStore& bodies, const std::vector<int>& staticIds);
+	void Clear();
+
+	int GetNumBodies() const { return (int)bodiesBounds.size(); }
+
+	// Adds a pair between the body and every static body whose bounds overlap its bounds
+	void Query(const int id, const Bounds& bounds, std::vector<CollisionPair>& finalPairs) const;
+
+private:
+	DynamicAABBTree tree;
+	std::vector<Bounds> bodiesBounds;
+	std::vector<int> bodiesIds;
+};
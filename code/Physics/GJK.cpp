@@ -0,0 +1,592 @@
+#include "GJK.h"
+#include "Shape.h"
+#include <vector>
+#include <algorithm>
+
+
+// A point of the Minkowski difference with the support points of both shapes it comes from
+struct SupportPoint
+{
+	Vec3 xyz;
+	Vec3 ptA;
+	Vec3 ptB;
+};
+
+static SupportPoint Support(const ConstBody& a, const ConstBody& b, Vec3 dir, const float bias)
+{
+	dir.Normalize();
+
+	SupportPoint point;
+	point.ptA = a.shape->Support(dir, a.position, a.orientation, bias);
+	point.ptB = b.shape->Support(dir * -1.0f, b.position, b.orientation, bias);
+	point.xyz = point.ptA - point.ptB;
+	return point;
+}
+
+// Iterations after which the queries give up on refining, they only loop forever on degenerate shapes
+static const int maxGjkIterations = 32;
+static const int maxEpaIterations = 64;
+
+
+
+//=====================================
+// ========== SIGNED VOLUMES ==========
+//=====================================
+
+// Barycentric coordinates of the projection of the origin on the segment [s1, s2], clamped to it
+static void SignedVolume1D(const Vec3& s1, const Vec3& s2, float lambdas[2])
+{
+	const Vec3 ab = s2 - s1;
+	const Vec3 ap = Vec3(0.0f) - s1;
+	const Vec3 p0 = s1 + ab * ab.Dot(ap) / ab.GetLengthSqr();
+
+	// Works on the axis along which the segment is the longest
+	int idx = 0;
+	float mu_max = 0.0f;
+	for (int i = 0; i < 3; i++)
+	{
+		const float mu = s2[i] - s1[i];
+		if (mu * mu > mu_max * mu_max)
+		{
+			mu_max = mu;
+			idx = i;
+		}
+	}
+
+	const float a = s1[idx];
+	const float b = s2[idx];
+	const float p = p0[idx];
+
+	// Origin projects between both points
+	if ((p > a && p < b) || (p > b && p < a))
+	{
+		lambdas[0] = (b - p) / mu_max;
+		lambdas[1] = (p - a) / mu_max;
+		return;
+	}
+
+	// Origin projects outside the side of a
+	if ((a <= b && p <= a) || (a >= b && p >= a))
+	{
+		lambdas[0] = 1.0f;
+		lambdas[1] = 0.0f;
+		return;
+	}
+
+	lambdas[0] = 0.0f;
+	lambdas[1] = 1.0f;
+}
+
+static bool SameSign(const float a, const float b)
+{
+	return (a > 0.0f && b > 0.0f) || (a < 0.0f && b < 0.0f);
+}
+
+// Signed area of the triangle (a, b, c) projected on the plane of the axes x and y
+static float ProjectedArea(const Vec3& a, const Vec3& b, const Vec3& c, const int x, const int y)
+{
+	return (b[x] - a[x]) * (c[y] - a[y]) - (b[y] - a[y]) * (c[x] - a[x]);
+}
+
+// Barycentric coordinates of the point p of the plane of the triangle (s1, s2, s3), without any clamping
+static bool TriangleBarycentric(const Vec3& s1, const Vec3& s2, const Vec3& s3, const Vec3& p, float lambdas[3])
+{
+	// Works on the plane of axes on which the triangle has the largest area
+	int idx = 0;
+	float area_max = 0.0f;
+	for (int i = 0; i < 3; i++)
+	{
+		const float area = ProjectedArea(s1, s2, s3, (i + 1) % 3, (i + 2) % 3);
+		if (area * area > area_max * area_max)
+		{
+			idx = i;
+			area_max = area;
+		}
+	}
+	if (area_max == 0.0f) return false;
+
+	// Sub-triangles formed by the point and each edge
+	const int x = (idx + 1) % 3;
+	const int y = (idx + 2) % 3;
+	lambdas[0] = ProjectedArea(p, s2, s3, x, y) / area_max;
+	lambdas[1] = ProjectedArea(p, s3, s1, x, y) / area_max;
+	lambdas[2] = ProjectedArea(p, s1, s2, x, y) / area_max;
+	return true;
+}
+
+// Barycentric coordinates of the point of the triangle (s1, s2, s3) closest to the origin
+static void SignedVolume2D(const Vec3& s1, const Vec3& s2, const Vec3& s3, float lambdas[3])
+{
+	const Vec3 normal = (s2 - s1).Cross(s3 - s1);
+	const float normal_length_sqr = normal.GetLengthSqr();
+	if (normal_length_sqr > 0.0f)
+	{
+		// Projection of the origin on the plane of the triangle
+		const Vec3 p0 = normal * s1.Dot(normal) / normal_length_sqr;
+
+		float inside[3];
+		if (TriangleBarycentric(s1, s2, s3, p0, inside) && inside[0] > 0.0f && inside[1] > 0.0f && inside[2] > 0.0f)
+		{
+			lambdas[0] = inside[0];
+			lambdas[1] = inside[1];
+			lambdas[2] = inside[2];
+			return;
+		}
+	}
+
+	// Origin projects outside the triangle, the closest point is on one of its edges
+	const Vec3 points[3] = { s1, s2, s3 };
+	float closest_dist = 1e10f;
+	for (int i = 0; i < 3; i++)
+	{
+		const int j = (i + 1) % 3;
+		const int k = (i + 2) % 3;
+
+		float edge_lambdas[2];
+		SignedVolume1D(points[j], points[k], edge_lambdas);
+		const Vec3 pt = points[j] * edge_lambdas[0] + points[k] * edge_lambdas[1];
+		if (pt.GetLengthSqr() < closest_dist)
+		{
+			closest_dist = pt.GetLengthSqr();
+			lambdas[i] = 0.0f;
+			lambdas[j] = edge_lambdas[0];
+			lambdas[k] = edge_lambdas[1];
+		}
+	}
+}
+
+// Barycentric coordinates of the point of the tetrahedron (s1, s2, s3, s4) closest to the origin
+static void SignedVolume3D(const Vec3& s1, const Vec3& s2, const Vec3& s3, const Vec3& s4, float lambdas[4])
+{
+	// Cofactors of the last row of the matrix whose columns are the points with a fourth coordinate of 1
+	float cofactors[4];
+	cofactors[0] = -s2.Dot(s3.Cross(s4));
+	cofactors[1] = s1.Dot(s3.Cross(s4));
+	cofactors[2] = -s1.Dot(s2.Cross(s4));
+	cofactors[3] = s1.Dot(s2.Cross(s3));
+	const float determinant = cofactors[0] + cofactors[1] + cofactors[2] + cofactors[3];
+
+	// Origin inside the tetrahedron
+	if (SameSign(determinant, cofactors[0]) && SameSign(determinant, cofactors[1]) && SameSign(determinant, cofactors[2]) && SameSign(determinant, cofactors[3]))
+	{
+		for (int i = 0; i < 4; i++)
+		{
+			lambdas[i] = cofactors[i] / determinant;
+		}
+		return;
+	}
+
+	// The closest point is on one of the faces
+	const Vec3 points[4] = { s1, s2, s3, s4 };
+	float closest_dist = 1e10f;
+	for (int i = 0; i < 4; i++)
+	{
+		const int j = (i + 1) % 4;
+		const int k = (i + 2) % 4;
+
+		float face_lambdas[3];
+		SignedVolume2D(points[i], points[j], points[k], face_lambdas);
+		const Vec3 pt = points[i] * face_lambdas[0] + points[j] * face_lambdas[1] + points[k] * face_lambdas[2];
+		if (pt.GetLengthSqr() < closest_dist)
+		{
+			closest_dist = pt.GetLengthSqr();
+			std::fill(lambdas, lambdas + 4, 0.0f);
+			lambdas[i] = face_lambdas[0];
+			lambdas[j] = face_lambdas[1];
+			lambdas[k] = face_lambdas[2];
+		}
+	}
+}
+
+/// <summary>
+/// Finds the point of the simplex closest to the origin, and the direction towards the origin from it
+/// </summary>
+/// <returns>
+/// True if the origin is on the simplex
+/// </returns>
+static bool SimplexSignedVolumes(const SupportPoint* points, const int num, Vec3& newDir, float lambdas[4])
+{
+	std::fill(lambdas, lambdas + 4, 0.0f);
+
+	switch (num)
+	{
+	case 2:
+		SignedVolume1D(points[0].xyz, points[1].xyz, lambdas);
+		break;
+	case 3:
+		SignedVolume2D(points[0].xyz, points[1].xyz, points[2].xyz, lambdas);
+		break;
+	case 4:
+		SignedVolume3D(points[0].xyz, points[1].xyz, points[2].xyz, points[3].xyz, lambdas);
+		break;
+	default:
+		lambdas[0] = 1.0f;
+		break;
+	}
+
+	Vec3 closest(0.0f);
+	for (int i = 0; i < num; i++)
+	{
+		closest += points[i].xyz * lambdas[i];
+	}
+	newDir = closest * -1.0f;
+
+	const float epsilon = 0.0001f * 0.0001f;
+	return closest.GetLengthSqr() < epsilon;
+}
+
+static bool SimplexHasPoint(const SupportPoint* points, const int num, const SupportPoint& newPoint)
+{
+	const float precision = 1e-6f;
+	for (int i = 0; i < num; i++)
+	{
+		const Vec3 delta = points[i].xyz - newPoint.xyz;
+		if (delta.GetLengthSqr() < precision * precision) return true;
+	}
+	return false;
+}
+
+// Drops the points with a zero coordinate, they don't support the closest point anymore, and returns how many are left
+static int KeepSupportingPoints(SupportPoint* points, float lambdas[4])
+{
+	int num_valids = 0;
+	for (int i = 0; i < 4; i++)
+	{
+		if (lambdas[i] == 0.0f) continue;
+
+		points[num_valids] = points[i];
+		lambdas[num_valids] = lambdas[i];
+		num_valids++;
+	}
+
+	for (int i = num_valids; i < 4; i++)
+	{
+		lambdas[i] = 0.0f;
+	}
+	return num_valids;
+}
+
+
+
+//=====================================
+// =============== EPA ================
+//=====================================
+
+struct HullTriangle
+{
+	int a;
+	int b;
+	int c;
+};
+
+struct HullEdge
+{
+	int a;
+	int b;
+
+	bool operator==(const HullEdge& rhs) const
+	{
+		return (a == rhs.a && b == rhs.b) || (a == rhs.b && b == rhs.a);
+	}
+};
+
+static Vec3 TriangleNormal(const HullTriangle& tri, const std::vector<SupportPoint>& points)
+{
+	const Vec3& a = points[tri.a].xyz;
+	const Vec3& b = points[tri.b].xyz;
+	const Vec3& c = points[tri.c].xyz;
+
+	Vec3 normal = (b - a).Cross(c - a);
+	normal.Normalize();
+	return normal;
+}
+
+static float SignedDistanceToTriangle(const HullTriangle& tri, const Vec3& pt, const std::vector<SupportPoint>& points)
+{
+	const Vec3 normal = TriangleNormal(tri, points);
+	return normal.Dot(pt - points[tri.a].xyz);
+}
+
+static int ClosestTriangle(const std::vector<HullTriangle>& triangles, const std::vector<SupportPoint>& points)
+{
+	float min_dist_sqr = 1e10f;
+	int idx = -1;
+	for (int i = 0; i < (int)triangles.size(); i++)
+	{
+		const float dist = SignedDistanceToTriangle(triangles[i], Vec3(0.0f), points);
+		if (dist * dist < min_dist_sqr)
+		{
+			idx = i;
+			min_dist_sqr = dist * dist;
+		}
+	}
+	return idx;
+}
+
+static bool HullHasPoint(const Vec3& pt, const std::vector<HullTriangle>& triangles, const std::vector<SupportPoint>& points)
+{
+	const float epsilon = 0.001f * 0.001f;
+	for (const HullTriangle& tri : triangles)
+	{
+		if ((pt - points[tri.a].xyz).GetLengthSqr() < epsilon) return true;
+		if ((pt - points[tri.b].xyz).GetLengthSqr() < epsilon) return true;
+		if ((pt - points[tri.c].xyz).GetLengthSqr() < epsilon) return true;
+	}
+	return false;
+}
+
+static int CountTrianglesFacingPoint(const Vec3& pt, const std::vector<HullTriangle>& triangles, const std::vector<SupportPoint>& points)
+{
+	const auto facing = [&](const HullTriangle& tri) { return SignedDistanceToTriangle(tri, pt, points) > 0.0f; };
+	return (int)std::count_if(triangles.begin(), triangles.end(), facing);
+}
+
+static void RemoveTrianglesFacingPoint(const Vec3& pt, std::vector<HullTriangle>& triangles, const std::vector<SupportPoint>& points)
+{
+	const auto facing = [&](const HullTriangle& tri) { return SignedDistanceToTriangle(tri, pt, points) > 0.0f; };
+	triangles.erase(std::remove_if(triangles.begin(), triangles.end(), facing), triangles.end());
+}
+
+// Edges used by a single triangle, they surround the hole left by the removed triangles
+static void FindDanglingEdges(std::vector<HullEdge>& danglingEdges, const std::vector<HullTriangle>& triangles)
+{
+	danglingEdges.clear();
+
+	for (int i = 0; i < (int)triangles.size(); i++)
+	{
+		const HullTriangle& tri = triangles[i];
+		const HullEdge edges[3] = { { tri.a, tri.b }, { tri.b, tri.c }, { tri.c, tri.a } };
+		int counts[3] = { 0, 0, 0 };
+
+		for (int j = 0; j < (int)triangles.size(); j++)
+		{
+			if (j == i) continue;
+
+			const HullTriangle& other = triangles[j];
+			const HullEdge other_edges[3] = { { other.a, other.b }, { other.b, other.c }, { other.c, other.a } };
+			for (int k = 0; k < 3; k++)
+			{
+				if (edges[k] == other_edges[0] || edges[k] == other_edges[1] || edges[k] == other_edges[2])
+				{
+					counts[k]++;
+				}
+			}
+		}
+
+		for (int k = 0; k < 3; k++)
+		{
+			if (counts[k] == 0)
+			{
+				danglingEdges.push_back(edges[k]);
+			}
+		}
+	}
+}
+
+// Hull of an expansion, kept from one call to the next so the narrow phase tasks don't allocate it for every pair
+struct EPAScratch
+{
+	std::vector<SupportPoint> points;
+	std::vector<HullTriangle> triangles;
+	std::vector<HullEdge> danglingEdges;
+};
+
+// Expands the tetrahedron holding the origin up to the face of the Minkowski difference closest to it
+static void EPAExpand(const ConstBody& a, const ConstBody& b, const float bias, const SupportPoint simplexPoints[4], Vec3& ptOnA, Vec3& ptOnB, Vec3& normalBA)
+{
+	// One per thread, the pairs are intersected in parallel
+	static thread_local EPAScratch scratch;
+	std::vector<SupportPoint>& points = scratch.points;
+	std::vector<HullTriangle>& triangles = scratch.triangles;
+	std::vector<HullEdge>& dangling_edges = scratch.danglingEdges;
+	points.clear();
+	triangles.clear();
+	dangling_edges.clear();
+
+	Vec3 center(0.0f);
+	for (int i = 0; i < 4; i++)
+	{
+		points.push_back(simplexPoints[i]);
+		center += simplexPoints[i].xyz;
+	}
+	center *= 0.25f;
+
+	// Faces of the tetrahedron, all facing outside
+	for (int i = 0; i < 4; i++)
+	{
+		HullTriangle tri{ i, (i + 1) % 4, (i + 2) % 4 };
+		const int unused_point = (i + 3) % 4;
+		if (SignedDistanceToTriangle(tri, points[unused_point].xyz, points) > 0.0f)
+		{
+			std::swap(tri.a, tri.b);
+		}
+		triangles.push_back(tri);
+	}
+
+	for (int iteration = 0; iteration < maxEpaIterations; iteration++)
+	{
+		const int idx = ClosestTriangle(triangles, points);
+		const Vec3 normal = TriangleNormal(triangles[idx], points);
+		const SupportPoint new_point = Support(a, b, normal, bias);
+
+		// Stops when the hull can't grow any further towards the closest face
+		if (HullHasPoint(new_point.xyz, triangles, points)) break;
+		if (SignedDistanceToTriangle(triangles[idx], new_point.xyz, points) <= 0.0f) break;
+
+		// Replaces the triangles the new point sees by a fan from the new point to the edges of the hole
+		const int num_facing = CountTrianglesFacingPoint(new_point.xyz, triangles, points);
+		if (num_facing == 0 || num_facing == (int)triangles.size()) break;
+
+		RemoveTrianglesFacingPoint(new_point.xyz, triangles, points);
+		FindDanglingEdges(dangling_edges, triangles);
+		if (dangling_edges.empty()) break;
+
+		const int new_idx = (int)points.size();
+		points.push_back(new_point);
+		for (const HullEdge& edge : dangling_edges)
+		{
+			HullTriangle tri{ new_idx, edge.b, edge.a };
+			if (SignedDistanceToTriangle(tri, center, points) > 0.0f)
+			{
+				std::swap(tri.b, tri.c);
+			}
+			triangles.push_back(tri);
+		}
+	}
+
+	// Projection of the origin on the closest face, carried over to both shapes
+	const HullTriangle& tri = triangles[ClosestTriangle(triangles, points)];
+	const Vec3 normal = TriangleNormal(tri, points);
+	const Vec3 origin_on_face = normal * normal.Dot(points[tri.a].xyz);
+
+	float lambdas[3];
+	if (!TriangleBarycentric(points[tri.a].xyz, points[tri.b].xyz, points[tri.c].xyz, origin_on_face, lambdas))
+	{
+		lambdas[0] = 1.0f;
+		lambdas[1] = 0.0f;
+		lambdas[2] = 0.0f;
+	}
+
+	ptOnA = points[tri.a].ptA * lambdas[0] + points[tri.b].ptA * lambdas[1] + points[tri.c].ptA * lambdas[2];
+	ptOnB = points[tri.a].ptB * lambdas[0] + points[tri.b].ptB * lambdas[1] + points[tri.c].ptB * lambdas[2];
+
+	// The face normal, the points being too close to each other on shallow contacts to give a precise direction
+	normalBA = normal * -1.0f;
+}
+
+
+
+//=====================================
+// =============== GJK ================
+//=====================================
+
+bool GJK::DoesIntersect(const ConstBody& a, const ConstBody& b, const float bias, Vec3& ptOnA, Vec3& ptOnB, Vec3& normalBA)
+{
+	SupportPoint simplex_points[4];
+	simplex_points[0] = Support(a, b, Vec3(1.0f, 1.0f, 1.0f), 0.0f);
+	int num_points = 1;
+
+	float lambdas[4];
+	float closest_dist = 1e10f;
+	bool contains_origin = false;
+	Vec3 new_dir = simplex_points[0].xyz * -1.0f;
+
+	for (int iteration = 0; iteration < maxGjkIterations && !contains_origin; iteration++)
+	{
+		const SupportPoint new_point = Support(a, b, new_dir, 0.0f);
+
+		// The simplex can't grow any further
+		if (SimplexHasPoint(simplex_points, num_points, new_point)) break;
+
+		simplex_points[num_points++] = new_point;
+
+		// The new point didn't go past the origin, so the origin is outside the Minkowski difference
+		if (new_dir.Dot(new_point.xyz) < 0.0f) break;
+
+		contains_origin = SimplexSignedVolumes(simplex_points, num_points, new_dir, lambdas);
+		if (contains_origin) break;
+
+		// Stops if the simplex didn't get closer to the origin
+		const float dist = new_dir.GetLengthSqr();
+		if (dist >= closest_dist) break;
+		closest_dist = dist;
+
+		num_points = KeepSupportingPoints(simplex_points, lambdas);
+		contains_origin = num_points == 4;
+	}
+
+	if (!contains_origin) return false;
+
+	// EPA needs a tetrahedron, the origin lying on a smaller simplex is completed with points around it
+	if (num_points == 1)
+	{
+		simplex_points[num_points++] = Support(a, b, simplex_points[0].xyz * -1.0f, 0.0f);
+	}
+	if (num_points == 2)
+	{
+		Vec3 u, v;
+		(simplex_points[1].xyz - simplex_points[0].xyz).GetOrtho(u, v);
+		simplex_points[num_points++] = Support(a, b, u, 0.0f);
+	}
+	if (num_points == 3)
+	{
+		const Vec3 ab = simplex_points[1].xyz - simplex_points[0].xyz;
+		const Vec3 ac = simplex_points[2].xyz - simplex_points[0].xyz;
+		simplex_points[num_points++] = Support(a, b, ab.Cross(ac), 0.0f);
+	}
+
+	// Grows the simplex by the bias, so the shapes EPA works on are the grown ones
+	Vec3 center(0.0f);
+	for (int i = 0; i < 4; i++)
+	{
+		center += simplex_points[i].xyz;
+	}
+	center *= 0.25f;
+
+	for (int i = 0; i < 4; i++)
+	{
+		SupportPoint& point = simplex_points[i];
+		Vec3 dir = point.xyz - center;
+		dir.Normalize();
+		point.ptA += dir * bias;
+		point.ptB -= dir * bias;
+		point.xyz = point.ptA - point.ptB;
+	}
+
+	EPAExpand(a, b, bias, simplex_points, ptOnA, ptOnB, normalBA);
+	return true;
+}
+
+void GJK::ClosestPoints(const ConstBody& a, const ConstBody& b, Vec3& ptOnA, Vec3& ptOnB)
+{
+	SupportPoint simplex_points[4];
+	simplex_points[0] = Support(a, b, Vec3(1.0f, 1.0f, 1.0f), 0.0f);
+	int num_points = 1;
+
+	float lambdas[4] = { 1.0f, 0.0f, 0.0f, 0.0f };
+	float closest_dist = 1e10f;
+	Vec3 new_dir = simplex_points[0].xyz * -1.0f;
+
+	for (int iteration = 0; iteration < maxGjkIterations && num_points < 4; iteration++)
+	{
+		const SupportPoint new_point = Support(a, b, new_dir, 0.0f);
+		if (SimplexHasPoint(simplex_points, num_points, new_point)) break;
+
+		simplex_points[num_points++] = new_point;
+
+		SimplexSignedVolumes(simplex_points, num_points, new_dir, lambdas);
+		num_points = KeepSupportingPoints(simplex_points, lambdas);
+
+		const float dist = new_dir.GetLengthSqr();
+		if (dist >= closest_dist) break;
+		closest_dist = dist;
+	}
+
+	ptOnA.Zero();
+	ptOnB.Zero();
+	for (int i = 0; i < num_points; i++)
+	{
+		ptOnA += simplex_points[i].ptA * lambdas[i];
+		ptOnB += simplex_points[i].ptB * lambdas[i];
+	}
+}
@@ -0,0 +1,24 @@
+#pragma once
+#include "Body.h"
+
+
+/// <summary>
+/// Distance and penetration queries between two convex bodies, only using the support points of their shapes.
+/// GJK walks a simplex of the Minkowski difference A - B towards the origin, which is inside it when the bodies overlap.
+/// EPA then expands that simplex to the face of the Minkowski difference closest to the origin, giving the penetration.
+/// </summary>
+class GJK
+{
+public:
+	/// <summary>
+	/// Tests if the shapes of both bodies, grown by bias, overlap at the current positions and orientations
+	/// </summary>
+	/// <returns>
+	/// True if they do, ptOnA and ptOnB are then the deepest points of both grown shapes found by EPA,
+	/// and normalBA the normal of the face of the Minkowski difference they were found on, going from B to A
+	/// </returns>
+	static bool DoesIntersect(const ConstBody& a, const ConstBody& b, const float bias, Vec3& ptOnA, Vec3& ptOnB, Vec3& normalBA);
+
+	// Closest points of the shapes of two separated bodies
+	static void ClosestPoints(const ConstBody& a, const ConstBody& b, Vec3& ptOnA, Vec3& ptOnB);
+};
@@ -0,0 +1,193 @@
+#include "HashGrid.h"
+#include <algorithm>
+#include <math.h>
+
+
+bool HashGridBroadPhase::CellRange::operator==(const CellRange& rhs) const
+{
+	for (int k = 0; k < 3; k++)
+	{
+		if (mins[k] != rhs.mins[k] || maxs[k] != rhs.maxs[k]) return false;
+	}
+	return true;
+}
+
+
+void HashGridBroadPhase::Update(const std::vector<Bounds>& bodiesBounds, std::vector<CollisionPair>& finalPairs)
+{
+	const size_t num = bodiesBounds.size();
+
+	finalPairs.clear();
+	stats.numSweptPairs = 0;
+	stats.numRejectedPairs = 0;
+
+	// Bodies are only identified by their index in the scene, a removal shifts every id after it
+	if (num < proxies.size())
+	{
+		Clear();
+	}
+
+	proxies.resize(num);
+
+	for (int i = 0; i < (int)num; i++)
+	{
+		GridProxy proxy;
+		proxy.level = GetLevel(bodiesBounds[i]);
+		proxy.cells = GetCellRange(bodiesBounds[i], proxy.level);
+
+		// Most bodies stay in the same cells from one step to the next
+		if (proxy.level == proxies[i].level && proxy.cells == proxies[i].cells) continue;
+
+		if (proxies[i].level >= 0)
+		{
+			RemoveBody(i, proxies[i]);
+		}
+		InsertBody(i, proxy);
+		proxies[i] = proxy;
+	}
+
+	for (int i = 0; i < (int)num; i++)
+	{
+		FindPairs(i, bodiesBounds, finalPairs);
+	}
+}
+
+void HashGridBroadPhase::Clear()
+{
+	for (int level = 0; level < maxLevels; level++)
+	{
+		levels[level].clear();
+		levelCounts[level] = 0;
+	}
+
+	proxies.clear();
+}
+
+int HashGridBroadPhase::GetLevel(const Bounds& bounds) const
+{
+	const float size = std::max(bounds.WidthX(), std::max(bounds.WidthY(), bounds.WidthZ()));
+
+	int level = 0;
+	float cell_size = baseCellSize;
+	while (cell_size < size && level < maxLevels - 1)
+	{
+		cell_size *= 2.0f;
+		level++;
+	}
+	return level;
+}
+
+HashGridBroadPhase::CellRange HashGridBroadPhase::GetCellRange(const Bounds& bounds, const int level) const
+{
+	const float inverse_cell_size = 1.0f / (baseCellSize * (float)(1 << level));
+
+	CellRange range;
+	for (int k = 0; k < 3; k++)
+	{
+		range.mins[k] = (int)floorf(bounds.mins[k] * inverse_cell_size);
+		range.maxs[k] = (int)floorf(bounds.maxs[k] * inverse_cell_size);
+	}
+	return range;
+}
+
+unsigned long long HashGridBroadPhase::GetCellKey(const int x, const int y, const int z)
+{
+	// 21 bits per coordinate, offset so negative cells stay positive
+	const unsigned long long mask = (1ull << 21) - 1;
+	const unsigned long long offset = 1ull << 20;
+	return (((unsigned long long)x + offset) & mask) | ((((unsigned long long)y + offset) & mask) << 21) | ((((unsigned long long)z + offset) & mask) << 42);
+}
+
+void HashGridBroadPhase::InsertBody(const int id, const GridProxy& proxy)
+{
+	CellMap& cells = levels[proxy.level];
+	const CellRange& range = proxy.cells;
+
+	for (int x = range.mins[0]; x <= range.maxs[0]; x++)
+	{
+		for (int y = range.mins[1]; y <= range.maxs[1]; y++)
+		{
+			for (int z = range.mins[2]; z <= range.maxs[2]; z++)
+			{
+				cells[GetCellKey(x, y, z)].push_back(id);
+			}
+		}
+	}
+
+	levelCounts[proxy.level]++;
+}
+
+void HashGridBroadPhase::RemoveBody(const int id, const GridProxy& proxy)
+{
+	CellMap& cells = levels[proxy.level];
+	const CellRange& range = proxy.cells;
+
+	for (int x = range.mins[0]; x <= range.maxs[0]; x++)
+	{
+		for (int y = range.mins[1]; y <= range.maxs[1]; y++)
+		{
+			for (int z = range.mins[2]; z <= range.maxs[2]; z++)
+			{
+				CellMap::iterator cell = cells.find(GetCellKey(x, y, z));
+				if (cell == cells.end()) continue;
+
+				std::vector<int>& ids = cell->second;
+				std::vector<int>::iterator it = std::find(ids.begin(), ids.end(), id);
+				if (it != ids.end())
+				{
+					*it = ids.back();
+					ids.pop_back();
+				}
+			}
+		}
+	}
+
+	levelCounts[proxy.level]--;
+}
+
+void HashGridBroadPhase::FindPairs(const int id, const std::vector<Bounds>& bodiesBounds, std::vector<CollisionPair>& finalPairs)
+{
+	const GridProxy& proxy = proxies[id];
+	const Bounds& bounds = bodiesBounds[id];
+
+	// Pairs within the same level are found by the lowest id, pairs across levels by the body in the smallest level
+	for (int level = proxy.level; level < maxLevels; level++)
+	{
+		if (levelCounts[level] == 0) continue;
+
+		const CellMap& cells = levels[level];
+		const CellRange range = level == proxy.level ? proxy.cells : GetCellRange(bounds, level);
+
+		for (int x = range.mins[0]; x <= range.maxs[0]; x++)
+		{
+			for (int y = range.mins[1]; y <= range.maxs[1]; y++)
+			{
+				for (int z = range.mins[2]; z <= range.maxs[2]; z++)
+				{
+					CellMap::const_iterator cell = cells.find(GetCellKey(x, y, z));
+					if (cell == cells.end()) continue;
+
+					for (const int other : cell->second)
+					{
+						if (level == proxy.level && other <= id) continue;
+
+						// Two bodies can share up to 8 cells, only test them in the first one
+						const CellRange& other_range = proxies[other].cells;
+						if (x != std::max(range.mins[0], other_range.mins[0])) continue;
+						if (y != std::max(range.mins[1], other_range.mins[1])) continue;
+						if (z != std::max(range.mins[2], other_range.mins[2])) continue;
+
+						stats.numSweptPairs++;
+						if (!bounds.DoesIntersect(bodiesBounds[other]))
+						{
+							stats.numRejectedPairs++;
+							continue;
+						}
+
+						finalPairs.push_back(CollisionPair{ id, other });
+					}
+				}
+			}
+		}
+	}
+}
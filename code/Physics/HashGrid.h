@@ -0,0 +1,67 @@
+#pragma once
+#include <vector>
+#include <memory>
+#include <unordered_map>
+#include "Body.h"
+#include "Broadphase.h"
+#include "../Math/Bounds.h"
+
+
+/// <summary>
+/// Broadphase backend made of several uniform grids whose cell size doubles from one level to the next.
+/// Each body lives in the level whose cells are at least as large as its bounds, so it never covers
+/// more than 2x2x2 cells, and the cells are stored in a hash map so only the ones a body went through exist.
+/// A body is only rehashed when its bounds cross into another cell. Emptied cells are kept with their
+/// capacity, so bodies moving back and forth between cells don't allocate, until Clear drops them all.
+/// </summary>
+class HashGridBroadPhase
+{
+public:
+	HashGridBroadPhase(const float baseCellSizeP = 1.0f) : baseCellSize(baseCellSizeP) {}
+
+	// Finds the overlapping pairs among the swept bounds of the bodies, one per body
+	void Update(const std::vector<Bounds>& bodiesBounds, std::vector<CollisionPair>& finalPairs);
+
+	// Forces a full rebuild on the next update (call it when the body list is replaced)
+	void Clear();
+
+	const BroadPhaseStats& GetStats() const { return stats; }
+
+	static const int maxLevels = 16;
+
+private:
+	struct CellRange
+	{
+		int mins[3];
+		int maxs[3];
+
+		bool operator==(const CellRange& rhs) const;
+		bool operator!=(const CellRange& rhs) const { return !(*this == rhs); }
+	};
+
+	struct GridProxy
+	{
+		int level{ -1 };
+		CellRange cells;
+	};
+
+	typedef std::unordered_map<unsigned long long, std::vector<int>> CellMap;
+
+	int GetLevel(const Bounds& bounds) const;
+	CellRange GetCellRange(const Bounds& bounds, const int level) const;
+	static unsigned long long GetCellKey(const int x, const int y, const int z);
+
+	void InsertBody(const int id, const GridProxy& proxy);
+	void RemoveBody(const int id, const GridProxy& proxy);
+
+	void FindPairs(const int id, const std::vector<Bounds>& bodiesBounds, std::vector<CollisionPair>& finalPairs);
+
+	float baseCellSize;
+
+	CellMap levels[maxLevels];
+	int levelCounts[maxLevels]{};
+
+	std::vector<GridProxy> proxies;
+
+	BroadPhaseStats stats;
+};
@@ -1,51 +1,187 @@
 #include "Intersections.h"
+#include "CollisionDispatch.h"
+#include "GJK.h"
+#include <algorithm>
+#include <math.h>
 
-bool Intersections::Intersect(std::shared_ptr<Body> a, std::shared_ptr<Body> b, const float dt, Contact& contact)
+// Distance under which two convex bodies are considered touching
+static const float contactBias = 0.001f;
+
+// Advancement steps before two convex bodies are considered not colliding during the step
+static const int maxAdvanceIterations = 20;
+
+// Tilts of a body looking for more points of a contact, with the distance its farthest point moves by and the largest angle
+static const int numPerturbations = 4;
+static const float perturbationDistance = 0.02f;
+static const float maxPerturbationAngle = 0.1f;
+
+bool Intersections::Intersect(const ConstBody& a, const ConstBody& b, const float dt, Contact& contact)
 {
-	contact.a = a;
-	contact.b = b; 
-	const Vec3 ab = b->position - a->position;
+	const int pair_type = GetShapePairType(a.shape->GetType(), b.shape->GetType());
+	return GetPairFunction(pair_type)(a, b, dt, contact);
+}
+
+void Intersections::CompleteSphereContact(const ConstBody& a, const ConstBody& b, Contact& contact)
+{
+	const ShapeSphere* sphere_a = static_cast<const ShapeSphere*>(a.shape);
+	const ShapeSphere* sphere_b = static_cast<const ShapeSphere*>(b.shape);
+
+	// Where the bodies are at the time of impact, to get local space collision points
+	BodyData predicted_data_a = a.Predict(contact.timeOfImpact);
+	BodyData predicted_data_b = b.Predict(contact.timeOfImpact);
+	const ConstBody predicted_a(predicted_data_a);
+	const ConstBody predicted_b(predicted_data_b);
+
+	// Convert world space contacts to local space
+	contact.ptOnALocalSpace = predicted_a.WorldSpaceToBodySpace(contact.ptOnAWorldSpace);
+	contact.ptOnBLocalSpace = predicted_b.WorldSpaceToBodySpace(contact.ptOnBWorldSpace);
+
+	Vec3 ab = predicted_a.position - predicted_b.position;
 	contact.normal = ab; 
-	contact.normal.Normalize();
+	contact.normal.Normalize(); 
 
-	if (a->shape->GetType() == Shape::ShapeType::SHAPE_SPHERE && b->shape->GetType() == Shape::ShapeType::SHAPE_SPHERE)
+	// Calculate separation distance
+	float r = ab.GetMagnitude() - (sphere_a->radius + sphere_b->radius);
+	contact.separationDistance = r;
+}
+
+bool Intersections::IntersectStatic(const ConstBody& a, const ConstBody& b, Contact& contact)
+{
+	contact.timeOfImpact = 0.0f;
+
+	Vec3 pt_on_a, pt_on_b, normal;
+	if (GJK::DoesIntersect(a, b, contactBias, pt_on_a, pt_on_b, normal))
 	{
-		ShapeSphere* sphere_a = static_cast<ShapeSphere*>(a->shape);
-		ShapeSphere* sphere_b = static_cast<ShapeSphere*>(b->shape);
+		// Points are on the shapes grown by the bias, the normal goes from B to A like the one of spheres
+		pt_on_a += normal * contactBias;
+		pt_on_b -= normal * contactBias;
+
+		contact.normal = normal;
+		contact.ptOnAWorldSpace = pt_on_a;
+		contact.ptOnBWorldSpace = pt_on_b;
+		contact.ptOnALocalSpace = a.WorldSpaceToBodySpace(pt_on_a);
+		contact.ptOnBLocalSpace = b.WorldSpaceToBodySpace(pt_on_b);
+		contact.separationDistance = (pt_on_a - pt_on_b).Dot(normal);
+		return true;
+	}
 
-		Vec3 pos_a = a->position;
-		Vec3 pos_b = b->position;
-		Vec3 vel_a = a->linearVelocity;
-		Vec3 vel_b = b->linearVelocity;
+	GJK::ClosestPoints(a, b, pt_on_a, pt_on_b);
+	contact.ptOnAWorldSpace = pt_on_a;
+	contact.ptOnBWorldSpace = pt_on_b;
+	contact.ptOnALocalSpace = a.WorldSpaceToBodySpace(pt_on_a);
+	contact.ptOnBLocalSpace = b.WorldSpaceToBodySpace(pt_on_b);
+	contact.separationDistance = (pt_on_b - pt_on_a).GetMagnitude();
+	return false;
+}
 
-		if (Intersections::SphereSphereDynamic(*sphere_a, *sphere_b, pos_a, pos_b, vel_a, vel_b, dt,
-			contact.ptOnAWorldSpace, contact.ptOnBWorldSpace, contact.timeOfImpact))
-		{
-			// Step bodies forward to get local space collision points
-			a->Update(contact.timeOfImpact);
-			b->Update(contact.timeOfImpact);
+bool Intersections::ConservativeAdvance(const ConstBody& a, const ConstBody& b, const float dt, Contact& contact)
+{
+	float time_of_impact = 0.0f;
 
-			// Convert world space contacts to local space
-			contact.ptOnALocalSpace = a->WorldSpaceToBodySpace(contact.ptOnAWorldSpace);
-			contact.ptOnBLocalSpace = b->WorldSpaceToBodySpace(contact.ptOnBWorldSpace);
+	// Copies moved along the step, the views read them wherever they are predicted to
+	BodyData predicted_data_a = a.GetData();
+	BodyData predicted_data_b = b.GetData();
+	const ConstBody predicted_a(predicted_data_a);
+	const ConstBody predicted_b(predicted_data_b);
 
-			Vec3 ab = a->position - b->position;
-			contact.normal = ab; 
-			contact.normal.Normalize(); 
+	for (int iteration = 0; iteration < maxAdvanceIterations; iteration++)
+	{
+		if (IntersectStatic(predicted_a, predicted_b, contact))
+		{
+			contact.timeOfImpact = time_of_impact;
+			return true;
+		}
 
-			// Unwind time step
-			a->Update(-contact.timeOfImpact);
-			b->Update(-contact.timeOfImpact);
+		Vec3 ab = contact.ptOnBWorldSpace - contact.ptOnAWorldSpace;
+		ab.Normalize();
+
+		// Fastest the closest points can come together along ab, the rotations are bounded in body space
+		const Vec3 relative_velocity = predicted_a.linearVelocity - predicted_b.linearVelocity;
+		const Quat inverse_orient_a = predicted_a.orientation.Inverse();
+		const Quat inverse_orient_b = predicted_b.orientation.Inverse();
+		float ortho_speed = relative_velocity.Dot(ab);
+		ortho_speed += a.shape->FastestLinearSpeed(inverse_orient_a.RotatePoint(predicted_a.angularVelocity), inverse_orient_a.RotatePoint(ab));
+		ortho_speed += b.shape->FastestLinearSpeed(inverse_orient_b.RotatePoint(predicted_b.angularVelocity), inverse_orient_b.RotatePoint(ab * -1.0f));
+		if (ortho_speed <= 0.0f) return false;
+
+		// They can't touch before they covered their distance at that speed
+		const float time_to_go = contact.separationDistance / ortho_speed;
+		if (time_of_impact + time_to_go > dt) return false;
+
+		time_of_impact += time_to_go;
+		predicted_data_a = a.Predict(time_of_impact);
+		predicted_data_b = b.Predict(time_of_impact);
+	}
 
-			// Calculate separation distance
-			float r = ab.GetMagnitude() - (sphere_a->radius + sphere_b->radius);
-			contact.separationDistance = r;
+	// Out of iterations while still closing within the step: they are reported touching where they got to,
+	// the last advancement only leaves a gap too thin to cross one more time
+	if (!IntersectStatic(predicted_a, predicted_b, contact))
+	{
+		// Closest points are filled in, the normal goes from B to A like the one of a hit
+		contact.normal = contact.ptOnAWorldSpace - contact.ptOnBWorldSpace;
+		contact.normal.Normalize();
+	}
+	contact.timeOfImpact = time_of_impact;
+	return true;
+}
 
-			return true;
+int Intersections::FindPerturbedContacts(const ConstBody& a, const ConstBody& b, const Contact& contact, Contact* perturbedContacts, const int maxContacts)
+{
+	const bool sphere_a = a.shape->GetType() == Shape::ShapeType::SHAPE_SPHERE;
+	const bool sphere_b = b.shape->GetType() == Shape::ShapeType::SHAPE_SPHERE;
+	if (sphere_a && sphere_b) return 0;
+
+	// The smallest body is tilted, so the angle is large enough to reach its other points
+	const Bounds bounds_a = a.shape->GetBounds();
+	const Bounds bounds_b = b.shape->GetBounds();
+	const float radius_a = (bounds_a.maxs - bounds_a.mins).GetMagnitude() * 0.5f;
+	const float radius_b = (bounds_b.maxs - bounds_b.mins).GetMagnitude() * 0.5f;
+	const bool tilt_a = sphere_b || (!sphere_a && radius_a < radius_b);
+	const float angle = std::min(perturbationDistance / (tilt_a ? radius_a : radius_b), maxPerturbationAngle);
+
+	Vec3 u, v;
+	contact.normal.GetOrtho(u, v);
+
+	int num_contacts = 0;
+	for (int i = 0; i < numPerturbations && num_contacts < maxContacts; i++)
+	{
+		// Axes are half a step off the ones of Vec3::GetOrtho, so a box lying on a face dips a corner rather than an edge
+		const float turn = 2.0f * 3.14159265f * (i + 0.5f) / numPerturbations;
+		const Vec3 axis = u * cosf(turn) + v * sinf(turn);
+
+		// The body turns around its center of mass, which stays where it is
+		BodyData tilted_data = (tilt_a ? a : b).GetData();
+		Body tilted(tilted_data);
+		const Vec3 center_of_mass = tilted.GetCenterOfMassWorldSpace();
+		tilted.orientation = Quat(axis, angle) * tilted.orientation;
+		tilted.orientation.Normalize();
+		tilted.position += center_of_mass - tilted.GetCenterOfMassWorldSpace();
+
+		Contact tilted_contact;
+		if (!IntersectStatic(tilt_a ? tilted : a, tilt_a ? b : tilted, tilted_contact)) continue;
+
+		Vec3 pt_on_a = tilted_contact.ptOnAWorldSpace;
+		Vec3 pt_on_b = tilted_contact.ptOnBWorldSpace;
+		if (tilt_a)
+		{
+			pt_on_a = a.BodySpaceToWorldSpace(tilted.WorldSpaceToBodySpace(pt_on_a));
 		}
+		else
+		{
+			pt_on_b = b.BodySpaceToWorldSpace(tilted.WorldSpaceToBodySpace(pt_on_b));
+		}
+
+		Contact& perturbed_contact = perturbedContacts[num_contacts++];
+		perturbed_contact = contact;
+		perturbed_contact.ptOnAWorldSpace = pt_on_a;
+		perturbed_contact.ptOnBWorldSpace = pt_on_b;
+		perturbed_contact.ptOnALocalSpace = a.WorldSpaceToBodySpace(pt_on_a);
+		perturbed_contact.ptOnBLocalSpace = b.WorldSpaceToBodySpace(pt_on_b);
+		perturbed_contact.separationDistance = (pt_on_a - pt_on_b).Dot(contact.normal);
+		perturbed_contact.timeOfImpact = 0.0f;
 	}
 
-	return false;
+	return num_contacts;
 }
 
 bool Intersections::RaySphere(const Vec3& rayStart, const Vec3& rayDir, const Vec3& sphereCenter, const float sphereRadius, float& t0, float& t1)
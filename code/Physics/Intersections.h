@@ -1,5 +1,4 @@
 #pragma once
-#include <memory>
 #include "Body.h"
 #include "Shape.h"
 #include "Contact.h"
@@ -7,7 +6,44 @@
 class Intersections
 {
 public:
-	static bool Intersect(std::shared_ptr<Body> a, std::shared_ptr<Body>, const float dt, Contact& contact);
+	/// <summary>
+	/// Find the first contact between two bodies over dt, from where their motion will take them.
+	/// The kernel is picked from the collision function matrix of CollisionDispatch.
+	/// The bodies are only read, so pairs can be tested on several threads at once.
+	/// The indices of the bodies (contact.idA and contact.idB) are left to the caller.
+	/// </summary>
+	static bool Intersect(const ConstBody& a, const ConstBody& b, const float dt, Contact& contact);
+
+	// Fills the local space points, normal and separation of a contact between two spheres whose world space points and time of impact are known
+	static void CompleteSphereContact(const ConstBody& a, const ConstBody& b, Contact& contact);
+
+	/// <summary>
+	/// Tests two convex bodies where they are now with GJK, and fills the contact from EPA if they touch.
+	/// If they don't, the contact still gets their closest points and their separation distance.
+	/// </summary>
+	/// <returns>
+	/// True if the bodies touch or overlap
+	/// </returns>
+	static bool IntersectStatic(const ConstBody& a, const ConstBody& b, Contact& contact);
+
+	/// <summary>
+	/// Finds the time of impact of two convex bodies over dt by conservative advancement: the bodies are moved by the time
+	/// they can't collide in, from their distance and the fastest their closest points can come together, until they touch.
+	/// Rotations are bounded with Shape::FastestLinearSpeed, so spinning boxes don't tunnel either.
+	/// If they are still closing when the iterations run out, the contact is reported where they got to.
+	/// </summary>
+	static bool ConservativeAdvance(const ConstBody& a, const ConstBody& b, const float dt, Contact& contact);
+
+	/// <summary>
+	/// Finds more points of a contact between two convex bodies where they are now, for a contact manifold.
+	/// GJK and EPA only give one point, so one of the bodies is tilted a little around axes spread around the normal,
+	/// and the points found against the tilted body are carried back on the body where it really is.
+	/// Sphere against sphere has nothing more to give, so does a sphere tilted around its center.
+	/// </summary>
+	/// <returns>
+	/// Number of contacts written to perturbedContacts, at most maxContacts
+	/// </returns>
+	static int FindPerturbedContacts(const ConstBody& a, const ConstBody& b, const Contact& contact, Contact* perturbedContacts, const int maxContacts);
 
 	static bool RaySphere(const Vec3& rayStart, const Vec3& rayDir, const Vec3& sphereCenter, const float sphereRadius, float& t0, float& t1);
 	static bool SphereSphereDynamic(const ShapeSphere& shapeA, const ShapeSphere& shapeB, const Vec3& posA, const Vec3& posB,
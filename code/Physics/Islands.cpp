@@ -0,0 +1,257 @@
+#include "Islands.h"
+#include <algorithm>
+#include <numeric>
+
+
+// Islands handled by one task below which splitting the work costs more than it saves
+static const int minIslandsPerTask = 4;
+
+
+void Islands::Update(BodyStore& bodies, const std::vector<CollisionPair>& pairs,
+	const std::vector<Contact>& contacts, PairCache& pairCache, FrameArena& frameArena, const float dt_sec)
+{
+	Build(bodies, pairs, contacts);
+	WakeIslands(bodies);
+
+	// Islands share no moving body, each task resolves its own range of them with its own scheduler.
+	// Bodies with an infinite mass are shared, but they are only read until the islands are done.
+	const int num_islands = (int)islands.size();
+	const int num_tasks = serial ? 1 : std::max(1, std::min(threadPool.GetNumThreads() * 4, num_islands / minIslandsPerTask));
+	if ((int)schedulers.size() < num_tasks)
+	{
+		schedulers.resize(num_tasks);
+		solvers.resize(num_tasks);
+	}
+
+	threadPool.ParallelFor(num_tasks, [&](const int task)
+	{
+		int begin, end;
+		ThreadPool::GetTaskRange(task, num_tasks, num_islands, begin, end);
+
+		for (int island = begin; island < end; island++)
+		{
+			if (solverType == ContactSolverType::SEQUENTIAL_IMPULSE)
+			{
+				solvers[task].settings = solverSettings;
+				solvers[task].Solve(bodies, *this, island, contacts, pairCache, frameArena, dt_sec);
+			}
+			else
+			{
+				schedulers[task].settings = schedulerSettings;
+				schedulers[task].Resolve(bodies, *this, island, contacts, pairCache, dt_sec);
+			}
+
+			const Island& current_island = islands[island];
+			UpdateSleep(bodies, islandBodies.data() + current_island.firstBody, current_island.numBodies, dt_sec);
+		}
+	});
+
+	for (const int id : freeBodies)
+	{
+		bodies[id].Update(dt_sec);
+
+		if (bodies.inverseMasses[id] == 0.0f) continue;
+		UpdateSleep(bodies, &id, 1, dt_sec);
+	}
+}
+
+void Islands::WakeIslands(BodyStore& bodies) const
+{
+	// Gravity skips the sleeping bodies, one left asleep on a body sliding away would hang in the air
+	for (const Island& island : islands)
+	{
+		const int* ids = islandBodies.data() + island.firstBody;
+
+		bool moves = false;
+		for (int i = 0; i < island.numBodies && !moves; i++)
+		{
+			const int id = ids[i];
+			moves = !bodies.sleeps[id].isSleeping && bodies[id].GetMotionEnergy() >= sleepEnergyThreshold;
+		}
+		if (!moves) continue;
+
+		for (int i = 0; i < island.numBodies; i++)
+		{
+			Body body = bodies[ids[i]];
+			if (body.isSleeping) body.Wake();
+		}
+	}
+}
+
+void Islands::UpdateSleep(BodyStore& bodies, const int* ids, const int numIds, const float dt_sec) const
+{
+	if (!allowSleep) return;
+
+	// A body resting on another one only stays still as long as the other one does, so they all fall asleep together
+	float min_timer = timeToSleep;
+	for (int i = 0; i < numIds; i++)
+	{
+		Body body = bodies[ids[i]];
+		if (body.isSleeping) continue;
+
+		if (body.GetMotionEnergy() < sleepEnergyThreshold)
+		{
+			body.sleepTimer += dt_sec;
+		}
+		else
+		{
+			body.sleepTimer = 0.0f;
+		}
+		min_timer = std::min(min_timer, body.sleepTimer);
+	}
+	if (min_timer < timeToSleep) return;
+
+	for (int i = 0; i < numIds; i++)
+	{
+		Body body = bodies[ids[i]];
+		if (!body.isSleeping) body.Sleep();
+	}
+}
+
+void Islands::Clear()
+{
+	for (ContactScheduler& scheduler : schedulers)
+	{
+		scheduler.Clear();
+	}
+	for (ContactSolver& solver : solvers)
+	{
+		solver.Clear();
+	}
+}
+
+void Islands::Build(const BodyStore& bodies, const std::vector<CollisionPair>& pairs, const std::vector<Contact>& contacts)
+{
+	const int num_bodies = (int)bodies.size();
+
+	parents.resize(num_bodies);
+	std::iota(parents.begin(), parents.end(), 0);
+
+	// islandOfBody first marks the moving bodies having a pair
+	islandOfBody.assign(num_bodies, -1);
+	for (const CollisionPair& pair : pairs)
+	{
+		const bool moves_a = bodies.inverseMasses[pair.a] != 0.0f;
+		const bool moves_b = bodies.inverseMasses[pair.b] != 0.0f;
+		if (moves_a) islandOfBody[pair.a] = 0;
+		if (moves_b) islandOfBody[pair.b] = 0;
+		if (moves_a && moves_b) Merge(pair.a, pair.b);
+	}
+
+	// Islands are numbered in the order of their first body, so they don't depend on the union-find
+	islands.clear();
+	freeBodies.clear();
+	localIndex.assign(num_bodies, -1);
+	std::vector<int>& island_of_root = parents;
+	bodyRoots.assign(num_bodies, -1);
+	for (int i = 0; i < num_bodies; i++)
+	{
+		if (islandOfBody[i] < 0)
+		{
+			freeBodies.push_back(i);
+			continue;
+		}
+		bodyRoots[i] = FindRoot(i);
+	}
+
+	// The forest isn't needed anymore, its array now maps a root to its island
+	std::fill(island_of_root.begin(), island_of_root.end(), -1);
+	for (int i = 0; i < num_bodies; i++)
+	{
+		if (bodyRoots[i] < 0) continue;
+
+		int& island = island_of_root[bodyRoots[i]];
+		if (island < 0)
+		{
+			island = (int)islands.size();
+			islands.push_back(Island{ 0, 0, 0, 0, 0, 0 });
+		}
+		islandOfBody[i] = island;
+		localIndex[i] = islands[island].numBodies++;
+	}
+
+	// Pairs and contacts go to the island of their moving body
+	auto island_of = [&](const int a, const int b)
+	{
+		return islandOfBody[a] >= 0 ? islandOfBody[a] : islandOfBody[b];
+	};
+	for (const CollisionPair& pair : pairs)
+	{
+		const int island = island_of(pair.a, pair.b);
+		if (island >= 0) islands[island].numPairs++;
+	}
+	for (const Contact& contact : contacts)
+	{
+		const int island = island_of(contact.idA, contact.idB);
+		if (island >= 0) islands[island].numContacts++;
+	}
+
+	int first_body = 0, first_pair = 0, first_contact = 0;
+	for (Island& island : islands)
+	{
+		island.firstBody = first_body;
+		island.firstPair = first_pair;
+		island.firstContact = first_contact;
+		first_body += island.numBodies;
+		first_pair += island.numPairs;
+		first_contact += island.numContacts;
+	}
+
+	// Filled in order, so every island keeps the order of the bodies, pairs and contacts
+	islandBodies.resize(first_body);
+	islandPairs.resize(first_pair);
+	islandContacts.resize(first_contact);
+	for (int i = 0; i < num_bodies; i++)
+	{
+		if (islandOfBody[i] < 0) continue;
+
+		const Island& island = islands[islandOfBody[i]];
+		islandBodies[island.firstBody + localIndex[i]] = i;
+	}
+
+	fillCounts.assign(islands.size(), 0);
+	for (const CollisionPair& pair : pairs)
+	{
+		const int island = island_of(pair.a, pair.b);
+		if (island < 0) continue;
+
+		islandPairs[islands[island].firstPair + fillCounts[island]++] = pair;
+	}
+
+	std::fill(fillCounts.begin(), fillCounts.end(), 0);
+	for (int c = 0; c < (int)contacts.size(); c++)
+	{
+		const int island = island_of(contacts[c].idA, contacts[c].idB);
+		if (island < 0) continue;
+
+		islandContacts[islands[island].firstContact + fillCounts[island]++] = c;
+	}
+}
+
+int Islands::FindRoot(int body)
+{
+	while (parents[body] != body)
+	{
+		// Path halving, every other node points to its grandparent
+		parents[body] = parents[parents[body]];
+		body = parents[body];
+	}
+	return body;
+}
+
+void Islands::Merge(const int a, const int b)
+{
+	const int root_a = FindRoot(a);
+	const int root_b = FindRoot(b);
+	if (root_a == root_b) return;
+
+	// The lower root is kept
+	if (root_a < root_b)
+	{
+		parents[root_b] = root_a;
+	}
+	else
+	{
+		parents[root_a] = root_b;
+	}
+}
@@ -0,0 +1,114 @@
+#pragma once
+#include <vector>
+#include "BodyStore.h"
+#include "Contact.h"
+#include "Broadphase.h"
+#include "PairCache.h"
+#include "ThreadPool.h"
+#include "ContactScheduler.h"
+#include "ContactSolver.h"
+
+
+// Bodies, pairs and contacts of an island are ranges of the arrays of Islands
+struct Island
+{
+	int firstBody;
+	int numBodies;
+	int firstPair;
+	int numPairs;
+	int firstContact;
+	int numContacts;
+};
+
+
+// How the contacts of an island are resolved
+enum class ContactSolverType
+{
+	// Contacts one at a time in time of impact order, see ContactScheduler
+	TIME_OF_IMPACT,
+	// Contact manifolds solved together for a few iterations, see ContactSolver
+	SEQUENTIAL_IMPULSE
+};
+
+
+/// <summary>
+/// Splits the bodies in islands that can't touch each other during the step, with a union-find over the pairs of the broadphase.
+/// The pairs are used rather than the contacts alone, so a body pushed by a contact can only meet bodies of its own island.
+/// Bodies with an infinite mass don't join islands: contacts never move them, so all the islands resting on the same
+/// ground stay apart. Each island resolves its contacts with the ContactScheduler or the ContactSolver of its task, the islands
+/// being spread on the thread pool.
+/// An island falls asleep as a whole once all its bodies have been slow for a while, and wakes up as a whole when one
+/// of its bodies moves.
+/// </summary>
+class Islands
+{
+public:
+	Islands(ThreadPool& threadPoolP) : threadPool(threadPoolP) {}
+
+	// Builds the islands of the step, resolves their contacts over dt_sec and moves every body to the end of the step.
+	// The solvers take their temporaries from frameArena.
+	void Update(BodyStore& bodies, const std::vector<CollisionPair>& pairs,
+		const std::vector<Contact>& contacts, PairCache& pairCache, FrameArena& frameArena, const float dt_sec);
+
+	// Releases the bodies held by the schedulers (call it when the body list is replaced)
+	void Clear();
+
+	int GetNumIslands() const { return (int)islands.size(); }
+	const Island& GetIsland(const int island) const { return islands[island]; }
+
+	// Ids of the bodies of the islands, in the order of the islands
+	const std::vector<int>& GetBodies() const { return islandBodies; }
+	// Pairs of the islands, in the order of the islands
+	const std::vector<CollisionPair>& GetPairs() const { return islandPairs; }
+	// Indices of the contacts of the islands, in the order of the islands
+	const std::vector<int>& GetContacts() const { return islandContacts; }
+
+	// Index of a body inside its island, -1 for bodies in no island
+	int GetLocalIndex(const int body) const { return localIndex[body]; }
+
+	// Resolves the islands on the calling thread only
+	bool serial{ false };
+
+	ContactSolverType solverType{ ContactSolverType::TIME_OF_IMPACT };
+	// Given to the scheduler or the solver of every task
+	ContactSchedulerSettings schedulerSettings;
+	ContactSolverSettings solverSettings;
+
+	// Islands whose bodies all stayed under sleepEnergyThreshold for timeToSleep seconds fall asleep
+	bool allowSleep{ true };
+	float sleepEnergyThreshold{ 0.5f };
+	float timeToSleep{ 0.5f };
+
+private:
+	void Build(const BodyStore& bodies, const std::vector<CollisionPair>& pairs, const std::vector<Contact>& contacts);
+
+	// Wakes the sleeping bodies of the islands where another body moves, they may not be resting on anything anymore
+	void WakeIslands(BodyStore& bodies) const;
+	// Puts the bodies to sleep if they have all been slow long enough
+	void UpdateSleep(BodyStore& bodies, const int* ids, const int numIds, const float dt_sec) const;
+
+	int FindRoot(int body);
+	void Merge(const int a, const int b);
+
+	ThreadPool& threadPool;
+
+	std::vector<Island> islands;
+	std::vector<int> islandBodies;
+	std::vector<CollisionPair> islandPairs;
+	std::vector<int> islandContacts;
+
+	// Bodies in no island: the ones with an infinite mass and the ones without any pair
+	std::vector<int> freeBodies;
+
+	std::vector<int> localIndex;
+	std::vector<int> islandOfBody;
+
+	// Union-find forest over the bodies
+	std::vector<int> parents;
+	std::vector<int> bodyRoots;
+	std::vector<int> fillCounts;
+
+	// One scheduler and one solver per task, kept from one step to the next
+	std::vector<ContactScheduler> schedulers;
+	std::vector<ContactSolver> solvers;
+};
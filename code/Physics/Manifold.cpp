@@ -0,0 +1,125 @@
+#include "Manifold.h"
+#include <algorithm>
+#include <math.h>
+
+
+// Distance the points of a contact can drift apart, along the normal or across it, before the contact is dropped
+static const float breakingDistance = 0.02f;
+
+
+void ContactManifold::Refresh(const ConstBody& a, const ConstBody& b)
+{
+	for (int i = numPoints - 1; i >= 0; i--)
+	{
+		ManifoldPoint& point = points[i];
+		const Vec3 pt_on_a = a.BodySpaceToWorldSpace(point.ptOnALocalSpace);
+		const Vec3 pt_on_b = b.BodySpaceToWorldSpace(point.ptOnBLocalSpace);
+
+		const Vec3 ab = pt_on_a - pt_on_b;
+		point.separation = ab.Dot(point.normal);
+		const Vec3 drift = ab - point.normal * point.separation;
+
+		if (point.separation > breakingDistance || drift.GetLengthSqr() > breakingDistance * breakingDistance)
+		{
+			// Order of the points doesn't matter, the last one takes the place of the dropped one
+			points[i] = points[numPoints - 1];
+			numPoints--;
+		}
+	}
+}
+
+void ContactManifold::AddContact(const Contact& contact)
+{
+	ManifoldPoint new_point;
+	new_point.ptOnALocalSpace = contact.ptOnALocalSpace;
+	new_point.ptOnBLocalSpace = contact.ptOnBLocalSpace;
+	new_point.normal = contact.normal;
+	new_point.separation = contact.separationDistance;
+
+	// The points share the normal of the last contact, so they don't push the bodies in slightly different directions
+	for (int i = 0; i < numPoints; i++)
+	{
+		points[i].normal = new_point.normal;
+	}
+
+	const int match = FindMatchingPoint(new_point);
+	if (match >= 0)
+	{
+		ManifoldPoint& point = points[match];
+		new_point.normalImpulse = point.normalImpulse;
+		new_point.tangentImpulse[0] = point.tangentImpulse[0];
+		new_point.tangentImpulse[1] = point.tangentImpulse[1];
+		point = new_point;
+		return;
+	}
+
+	if (numPoints < maxPoints)
+	{
+		points[numPoints++] = new_point;
+		return;
+	}
+
+	ReplacePoint(new_point);
+}
+
+int ContactManifold::FindMatchingPoint(const ManifoldPoint& newPoint) const
+{
+	int closest = -1;
+	float closest_distance_sqr = breakingDistance * breakingDistance;
+	for (int i = 0; i < numPoints; i++)
+	{
+		const float distance_sqr = (points[i].ptOnALocalSpace - newPoint.ptOnALocalSpace).GetLengthSqr();
+		if (distance_sqr < closest_distance_sqr)
+		{
+			closest = i;
+			closest_distance_sqr = distance_sqr;
+		}
+	}
+	return closest;
+}
+
+void ContactManifold::ReplacePoint(const ManifoldPoint& newPoint)
+{
+	const ManifoldPoint* candidates[maxPoints + 1];
+	for (int i = 0; i < maxPoints; i++)
+	{
+		candidates[i] = &points[i];
+	}
+	candidates[maxPoints] = &newPoint;
+
+	int deepest = 0;
+	for (int i = 1; i <= maxPoints; i++)
+	{
+		if (candidates[i]->separation < candidates[deepest]->separation) deepest = i;
+	}
+
+	// Area of the four points left without each candidate, measured from the largest cross product of two of their segments
+	int removed = -1;
+	float largest_area = -1.0f;
+	for (int i = 0; i <= maxPoints; i++)
+	{
+		if (i == deepest) continue;
+
+		Vec3 kept[maxPoints];
+		int num_kept = 0;
+		for (int j = 0; j <= maxPoints; j++)
+		{
+			if (j != i) kept[num_kept++] = candidates[j]->ptOnALocalSpace;
+		}
+
+		const float area_0 = (kept[0] - kept[1]).Cross(kept[2] - kept[3]).GetLengthSqr();
+		const float area_1 = (kept[0] - kept[2]).Cross(kept[1] - kept[3]).GetLengthSqr();
+		const float area_2 = (kept[0] - kept[3]).Cross(kept[1] - kept[2]).GetLengthSqr();
+		const float area = std::max(area_0, std::max(area_1, area_2));
+		if (area > largest_area)
+		{
+			largest_area = area;
+			removed = i;
+		}
+	}
+
+	// The new point is the one that adds the least, the manifold stays as it is
+	if (removed == maxPoints) return;
+
+	points[removed] = newPoint;
+}
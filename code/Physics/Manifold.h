@@ -0,0 +1,52 @@
+#pragma once
+#include "../Math/Vector.h"
+#include "Body.h"
+#include "Contact.h"
+
+
+// Contact point kept by a manifold, with the impulses the solver accumulated on it
+struct ManifoldPoint
+{
+	// Points in the space of each body, so they follow the bodies from one step to the next
+	Vec3 ptOnALocalSpace;
+	Vec3 ptOnBLocalSpace;
+	// From B to A, like the normal of the contacts
+	Vec3 normal;
+	// Distance between the points along the normal when the manifold was last refreshed, negative when they overlap
+	float separation{ 0.0f };
+
+	// Impulses accumulated by the solver, along the normal and along the two tangents Vec3::GetOrtho gives for it
+	float normalImpulse{ 0.0f };
+	float tangentImpulse[2]{ 0.0f, 0.0f };
+};
+
+
+/// <summary>
+/// Up to four contact points between two bodies, kept from one step to the next in the pair cache.
+/// The narrow phase only finds one point per step: the manifold gathers them as long as the bodies don't move away
+/// from them, so a box resting on the ground ends up held by its corners, and every point keeps the impulses
+/// of the last step for the solver to start from.
+/// Bodies a and b are the bodies of the cached pair, the lowest index first.
+/// </summary>
+class ContactManifold
+{
+public:
+	// Moves the points with the bodies and drops the ones they moved away from
+	void Refresh(const ConstBody& a, const ConstBody& b);
+
+	// Adds a contact found for (a, b), it takes the place and the impulses of the point it is close to
+	void AddContact(const Contact& contact);
+
+	void Clear() { numPoints = 0; }
+
+	static const int maxPoints = 4;
+	int numPoints{ 0 };
+	ManifoldPoint points[maxPoints];
+
+private:
+	// Index of the point close enough to the new one to be the same, -1 if there is none
+	int FindMatchingPoint(const ManifoldPoint& newPoint) const;
+
+	// Manifold is full: keeps the deepest of the five points, and the other three spanning the largest area
+	void ReplacePoint(const ManifoldPoint& newPoint);
+};
@@ -0,0 +1,115 @@
+#include "NarrowPhase.h"
+#include "Intersections.h"
+#include <algorithm>
+
+
+// Pairs handled by one task below which splitting the work costs more than it saves
+static const int minPairsPerTask = 64;
+
+
+void NarrowPhase::Update(const BodyStore& bodies, const std::vector<CollisionPair>& pairs, PairCache& pairCache, const float dt_sec)
+{
+	// The cache is a hash map, its pairs are looked up before the parallel part. Each task then only writes to its own pairs.
+	candidates.clear();
+	for (const CollisionPair& pair : pairs)
+	{
+		if (bodies.inverseMasses[pair.a] == 0.0f && bodies.inverseMasses[pair.b] == 0.0f) continue;
+
+		candidates.push_back(Candidate{ pair, &pairCache.Touch(pair.a, pair.b) });
+	}
+
+	const int count = (int)candidates.size();
+	const unsigned int step = pairCache.GetStep();
+	const int num_tasks = serial ? 1 : std::max(1, std::min(threadPool.GetNumThreads() * 4, count / minPairsPerTask));
+	if ((int)tasksData.size() < num_tasks)
+	{
+		tasksData.resize(num_tasks);
+	}
+
+	threadPool.ParallelFor(num_tasks, [&](const int task)
+	{
+		int begin, end;
+		ThreadPool::GetTaskRange(task, num_tasks, count, begin, end);
+
+		TestPairs(bodies, begin, end, step, dt_sec, tasksData[task]);
+	});
+
+	// Tasks cover consecutive ranges of pairs, appending them in task order gives the serial order
+	contacts.clear();
+	for (int task = 0; task < num_tasks; task++)
+	{
+		contacts.insert(contacts.end(), tasksData[task].contacts.begin(), tasksData[task].contacts.end());
+	}
+}
+
+void NarrowPhase::Clear()
+{
+	candidates.clear();
+	contacts.clear();
+}
+
+void NarrowPhase::TestPairs(const BodyStore& bodies, const int begin, const int end, const unsigned int step,
+	const float dt_sec, TaskData& taskData)
+{
+	std::vector<BatchSlot>& batch_slots = taskData.batchSlots;
+	batch_slots.clear();
+	for (PairBatch& bucket : taskData.buckets)
+	{
+		bucket.Clear(bodies);
+		bucket.useSimd = useSimd;
+	}
+
+	// Sort the pairs by the types of their shapes
+	for (int i = begin; i < end; i++)
+	{
+		const CollisionPair& pair = candidates[i].pair;
+		const CachedPair& cached_pair = *candidates[i].cachedPair;
+
+		// Pairs still too far apart since their last check don't need the narrow phase
+		if (PairCache::IsStillSeparated(cached_pair, bodies[cached_pair.a], bodies[cached_pair.b], dt_sec))
+		{
+			batch_slots.push_back(BatchSlot{ -1, -1 });
+			continue;
+		}
+
+		const int bucket = GetShapePairType(bodies.shapes[pair.a]->GetType(), bodies.shapes[pair.b]->GetType());
+		batch_slots.push_back(BatchSlot{ bucket, taskData.buckets[bucket].Add(pair.a, pair.b) });
+	}
+
+	for (int bucket = 0; bucket < numShapePairTypes; bucket++)
+	{
+		if (taskData.buckets[bucket].GetNumPairs() == 0) continue;
+
+		GetPairBatchFunction(bucket)(taskData.buckets[bucket], dt_sec);
+	}
+
+	// Then read the results back in the order of the pairs
+	taskData.contacts.clear();
+	for (int i = begin; i < end; i++)
+	{
+		const BatchSlot& slot = batch_slots[i - begin];
+		if (slot.bucket < 0) continue;
+
+		const CollisionPair& pair = candidates[i].pair;
+		CachedPair& cached_pair = *candidates[i].cachedPair;
+		const PairBatch& bucket = taskData.buckets[slot.bucket];
+
+		if (bucket.hits[slot.index])
+		{
+			Contact contact = bucket.contacts[slot.index];
+			contact.idA = pair.a;
+			contact.idB = pair.b;
+
+			cached_pair.contactStep = step;
+			cached_pair.normal = pair.a == cached_pair.a ? contact.normal : contact.normal * -1.0f;
+			cached_pair.timeOfImpact = contact.timeOfImpact;
+			cached_pair.separation = -1.0f;
+
+			taskData.contacts.push_back(contact);
+		}
+		else
+		{
+			PairCache::UpdateSeparation(cached_pair, bodies[cached_pair.a], bodies[cached_pair.b]);
+		}
+	}
+}
@@ -0,0 +1,66 @@
+#pragma once
+#include <vector>
+#include "BodyStore.h"
+#include "Contact.h"
+#include "Broadphase.h"
+#include "PairCache.h"
+#include "ThreadPool.h"
+#include "CollisionDispatch.h"
+
+
+/// <summary>
+/// Turns the pairs found by the broadphase into contacts.
+/// Pairs are tested on the thread pool with the side-effect free Intersections::Intersect, each task writing to its
+/// own buffer, and the buffers are appended in task order so the contacts come out in the order of the pairs.
+/// </summary>
+class NarrowPhase
+{
+public:
+	NarrowPhase(ThreadPool& threadPoolP) : threadPool(threadPoolP) {}
+
+	// Finds the contacts of the pairs over dt_sec and records what was found in the pair cache
+	void Update(const BodyStore& bodies, const std::vector<CollisionPair>& pairs, PairCache& pairCache, const float dt_sec);
+
+	// Forgets the last contacts (call it when the body list is replaced)
+	void Clear();
+
+	// Contacts found by the last update, in the order of the pairs
+	std::vector<Contact>& GetContacts() { return contacts; }
+
+	// Tests the pairs on the calling thread only
+	bool serial{ false };
+	// Solves the pairs with the SIMD kernels when there is one
+	bool useSimd{ true };
+
+private:
+	struct Candidate
+	{
+		CollisionPair pair;
+		CachedPair* cachedPair;
+	};
+
+	// Where the result of a candidate is, bucket is negative when it was skipped
+	struct BatchSlot
+	{
+		int bucket;
+		int index;
+	};
+
+	// Buffers of one task, kept from one step to the next
+	struct TaskData
+	{
+		std::vector<Contact> contacts;
+		// One bucket per pair of shape types
+		PairBatch buckets[numShapePairTypes];
+		std::vector<BatchSlot> batchSlots;
+	};
+
+	void TestPairs(const BodyStore& bodies, const int begin, const int end, const unsigned int step,
+		const float dt_sec, TaskData& taskData);
+
+	ThreadPool& threadPool;
+
+	std::vector<Candidate> candidates;
+	std::vector<TaskData> tasksData;
+	std::vector<Contact> contacts;
+};
@@ -0,0 +1,98 @@
+#include "PairCache.h"
+#include "Shape.h"
+#include <algorithm>
+#include <math.h>
+
+
+// Distance under which two bodies are not considered provably separated, above the tolerance of the narrow phase
+static const float separationMargin = 0.01f;
+
+// Radius of a sphere around the center of mass enclosing the shape whatever its orientation
+static float GetBoundingRadius(const Shape& shape)
+{
+	if (shape.GetType() == Shape::ShapeType::SHAPE_SPHERE)
+	{
+		return static_cast<const ShapeSphere&>(shape).radius;
+	}
+
+	const Bounds bounds = shape.GetBounds();
+	const Vec3 center_of_mass = shape.GetCenterOfMass();
+
+	Vec3 farthest;
+	for (int k = 0; k < 3; k++)
+	{
+		farthest[k] = std::max(fabsf(bounds.mins[k] - center_of_mass[k]), fabsf(bounds.maxs[k] - center_of_mass[k]));
+	}
+	return farthest.GetMagnitude();
+}
+
+
+void PairCache::EndStep()
+{
+	for (auto it = pairs.begin(); it != pairs.end();)
+	{
+		if (it->second.touchedStep != step)
+		{
+			it = pairs.erase(it);
+		}
+		else
+		{
+			++it;
+		}
+	}
+}
+
+CachedPair& PairCache::Touch(const int a, const int b)
+{
+	CachedPair& pair = pairs[GetKey(a, b)];
+	if (pair.createdStep == 0)
+	{
+		pair.a = std::min(a, b);
+		pair.b = std::max(a, b);
+		pair.createdStep = step;
+	}
+
+	pair.touchedStep = step;
+	return pair;
+}
+
+CachedPair* PairCache::Find(const int a, const int b)
+{
+	auto it = pairs.find(GetKey(a, b));
+	return it == pairs.end() ? nullptr : &it->second;
+}
+
+void PairCache::Clear()
+{
+	pairs.clear();
+	step = 0;
+}
+
+bool PairCache::IsStillSeparated(const CachedPair& pair, const ConstBody& a, const ConstBody& b, const float dt_sec)
+{
+	if (pair.separation <= 0.0f) return false;
+
+	// Bounding spheres are centered on the centers of mass, which rotations don't move
+	const Vec3 moved_a = a.GetCenterOfMassWorldSpace() - pair.centerOfMassA;
+	const Vec3 moved_b = b.GetCenterOfMassWorldSpace() - pair.centerOfMassB;
+	const Vec3 relative_velocity = a.linearVelocity - b.linearVelocity;
+
+	const float gap = pair.separation - moved_a.GetMagnitude() - moved_b.GetMagnitude() - relative_velocity.GetMagnitude() * dt_sec;
+	return gap > separationMargin;
+}
+
+void PairCache::UpdateSeparation(CachedPair& pair, const ConstBody& a, const ConstBody& b)
+{
+	pair.centerOfMassA = a.GetCenterOfMassWorldSpace();
+	pair.centerOfMassB = b.GetCenterOfMassWorldSpace();
+
+	const float distance = (pair.centerOfMassB - pair.centerOfMassA).GetMagnitude();
+	pair.separation = distance - GetBoundingRadius(*a.shape) - GetBoundingRadius(*b.shape);
+}
+
+unsigned long long PairCache::GetKey(const int a, const int b)
+{
+	const unsigned long long low = (unsigned int)std::min(a, b);
+	const unsigned long long high = (unsigned int)std::max(a, b);
+	return (low << 32) | high;
+}
@@ -0,0 +1,76 @@
+#pragma once
+#include <unordered_map>
+#include "Body.h"
+#include "Manifold.h"
+#include "../Math/Vector.h"
+
+
+/// <summary>
+/// What is remembered about a pair of bodies from one step to the next.
+/// Bodies are identified by their index in the scene, a is always the lowest one.
+/// </summary>
+struct CachedPair
+{
+	int a;
+	int b;
+
+	// Steps where the pair was first found by the broadphase, last found by it, and last found in contact
+	unsigned int createdStep{ 0 };
+	unsigned int touchedStep{ 0 };
+	unsigned int contactStep{ 0 };
+
+	// Last contact, with the normal oriented as the narrow phase gives it for (a, b)
+	Vec3 normal;
+	float timeOfImpact{ 0.0f };
+	// Impulse applied along the normal when the last contact was resolved, to warm start the solver
+	float normalImpulse{ 0.0f };
+	// Contact points gathered over the last steps, used by the sequential impulse solver
+	ContactManifold manifold;
+
+	// Lower bound of the distance between the two bodies, measured when their centers of mass were at these positions.
+	// Negative when nothing is known.
+	float separation{ -1.0f };
+	Vec3 centerOfMassA;
+	Vec3 centerOfMassB;
+};
+
+
+/// <summary>
+/// Pairs found by the broadphase, kept as long as the broadphase keeps finding them.
+/// It lets the narrow phase skip pairs that can't have closed the gap measured on an earlier step,
+/// and gives the solver the impulse of the last step to start from.
+/// </summary>
+class PairCache
+{
+public:
+	// Starts a new step, call it before touching the pairs found by the broadphase
+	void BeginStep() { step++; }
+	// Forgets the pairs the broadphase didn't find this step
+	void EndStep();
+
+	// Returns the pair of the two bodies and marks it as found this step, creating it if needed
+	CachedPair& Touch(const int a, const int b);
+	// Returns the pair of the two bodies, or nullptr if it isn't cached
+	CachedPair* Find(const int a, const int b);
+
+	void Clear();
+
+	unsigned int GetStep() const { return step; }
+	size_t GetNumPairs() const { return pairs.size(); }
+
+	/// <summary>
+	/// Check whether two bodies are still too far apart to touch by the end of the step, from the separation
+	/// cached on an earlier step, how much their centers of mass moved since then, and how much they can move in dt_sec.
+	/// Bodies a and b are the bodies of pair.a and pair.b, in that order.
+	/// </summary>
+	static bool IsStillSeparated(const CachedPair& pair, const ConstBody& a, const ConstBody& b, const float dt_sec);
+
+	// Records a lower bound of the distance between the bodies of pair.a and pair.b, from their bounding spheres
+	static void UpdateSeparation(CachedPair& pair, const ConstBody& a, const ConstBody& b);
+
+private:
+	static unsigned long long GetKey(const int a, const int b);
+
+	std::unordered_map<unsigned long long, CachedPair> pairs;
+	unsigned int step{ 0 };
+};
@@ -1,4 +1,19 @@
 #include "Shape.h"
+#include <algorithm>
+#include <math.h>
+
+//=====================================
+// ============= SHAPE ===============
+//=====================================
+
+Vec3 Shape::Support(const Vec3& dir, const Vec3& pos, const Quat& orient, const float bias) const
+{
+	// Only the direction goes to body space, then the single support point comes back to world space
+	const Vec3 dir_local = orient.Inverse().RotatePoint(dir);
+	const Vec3 pt = orient.RotatePoint(SupportLocal(dir_local)) + pos;
+	return pt + dir * bias;
+}
+
 
 //=====================================
 // ============ SPHERE ===============
@@ -30,7 +45,14 @@ Bounds ShapeSphere::GetBounds() const
 	return temp;
 }
 
-Vec3 ShapeSphere::Support(const Vec3& dir, const Vec3& pos, const Quat& orient, const float bias)
+Vec3 ShapeSphere::SupportLocal(const Vec3& dir) const
+{
+	Vec3 norm = dir;
+	norm.Normalize();
+	return norm * radius;
+}
+
+Vec3 ShapeSphere::Support(const Vec3& dir, const Vec3& pos, const Quat& orient, const float bias) const
 {
 	return pos + dir * (radius + bias);
 }
@@ -119,40 +141,378 @@ void ShapeBox::Build(const std::vector<Vec3> pts, const int num)
 	points.push_back(Vec3{ bounds.maxs.x, bounds.maxs.y, bounds.mins.z }); 
 
 	centerOfMass = (bounds.maxs + bounds.mins) * 0.5f; 
+	MarkChanged();
+}
+
+Vec3 ShapeBox::SupportLocal(const Vec3& dir) const
+{
+	// The furthest corner takes the max of the bounds on the axes where dir is positive, the min elsewhere
+	return Vec3{
+		dir.x > 0.0f ? bounds.maxs.x : bounds.mins.x,
+		dir.y > 0.0f ? bounds.maxs.y : bounds.mins.y,
+		dir.z > 0.0f ? bounds.maxs.z : bounds.mins.z };
+}
+
+float ShapeBox::FastestLinearSpeed(const Vec3& angularVelocity, const Vec3& dir) const
+{
+	float max_speed{ 0 };
+	for (int i = 0; i < (int)points.size(); i++) 
+	{
+		Vec3 r = points[i] - centerOfMass; 
+		Vec3 linear_velocity = angularVelocity.Cross(r); 
+		float speed = dir.Dot(linear_velocity); 
+		if (speed > max_speed) 
+		{
+			max_speed = speed;
+		}
+	}
+	return max_speed;
+}
+
+
+//=====================================
+// ============= CONVEX ==============
+//=====================================
+
+// Distance to its plane under which a point is on a triangle, relative to the size of the cloud
+static const float hullTolerance = 1e-5f;
+
+static Vec3 GetTriangleNormal(const std::vector<Vec3>& pts, const int* tri)
+{
+	Vec3 normal = (pts[tri[1]] - pts[tri[0]]).Cross(pts[tri[2]] - pts[tri[0]]);
+	normal.Normalize();
+	return normal;
+}
+
+static int FindFurthestPoint(const std::vector<Vec3>& pts, const Vec3& dir)
+{
+	int best = 0;
+	for (int i = 1; i < (int)pts.size(); i++)
+	{
+		if (dir.Dot(pts[i]) > dir.Dot(pts[best])) best = i;
+	}
+	return best;
 }
 
-Vec3 ShapeBox::Support(const Vec3& dir, const Vec3& pos, const Quat& orient, const float bias)
+// Grows a tetrahedron one point at a time: the triangles a point sees are replaced by a fan from the point
+// to their horizon. Returns false if the points are all on one plane.
+static bool BuildConvexHull(const std::vector<Vec3>& pts, std::vector<Vec3>& hullPoints, std::vector<int>& hullTriangles)
 {
-	// Find the point in furthest direction
-	Vec3 max_pt = orient.RotatePoint(points[0]) + pos;  
-	float max_dist = dir.Dot(max_pt); 
-	for (int i = 1; i < points.size(); i++)  
+	const int num = (int)pts.size();
+	if (num < 4) return false;
+
+	Bounds cloud;
+	for (const Vec3& pt : pts) cloud.Expand(pt);
+	const float epsilon = hullTolerance * std::max((cloud.maxs - cloud.mins).GetMagnitude(), 1.0f);
+
+	// First tetrahedron, from points as far apart as possible
+	int corners[4];
+	corners[0] = FindFurthestPoint(pts, Vec3(-1.0f, 0.0f, 0.0f));
+	float best_dist = 0.0f;
+	corners[1] = corners[0];
+	for (int i = 0; i < num; i++)
+	{
+		const float dist = (pts[i] - pts[corners[0]]).GetLengthSqr();
+		if (dist > best_dist) { best_dist = dist; corners[1] = i; }
+	}
+	if (best_dist <= epsilon * epsilon) return false;
+
+	const Vec3 axis = (pts[corners[1]] - pts[corners[0]]) * (1.0f / sqrtf(best_dist));
+	best_dist = 0.0f;
+	corners[2] = corners[0];
+	for (int i = 0; i < num; i++)
+	{
+		const Vec3 ray = pts[i] - pts[corners[0]];
+		const float dist = (ray - axis * ray.Dot(axis)).GetLengthSqr();
+		if (dist > best_dist) { best_dist = dist; corners[2] = i; }
+	}
+	if (best_dist <= epsilon * epsilon) return false;
+
+	const Vec3 plane_normal = GetTriangleNormal(pts, corners);
+	best_dist = 0.0f;
+	corners[3] = corners[0];
+	for (int i = 0; i < num; i++)
 	{
-		const Vec3 pt = orient.RotatePoint(points[i]) + pos;
-		const float dist = dir.Dot(pt);
+		const float dist = fabsf(plane_normal.Dot(pts[i] - pts[corners[0]]));
+		if (dist > best_dist) { best_dist = dist; corners[3] = i; }
+	}
+	if (best_dist <= epsilon) return false;
 
-		if (dist > max_dist) 
+	// Each face of the tetrahedron is wound so the corner it leaves out is behind it
+	std::vector<int> tris;
+	for (int k = 0; k < 4; k++)
+	{
+		int tri[3] = { corners[(k + 1) % 4], corners[(k + 2) % 4], corners[(k + 3) % 4] };
+		if (GetTriangleNormal(pts, tri).Dot(pts[corners[k]] - pts[tri[0]]) > 0.0f) std::swap(tri[1], tri[2]);
+		tris.insert(tris.end(), tri, tri + 3);
+	}
+
+	std::vector<bool> visible;
+	std::vector<int> edges;
+	for (int i = 0; i < num; i++)
+	{
+		if (std::find(corners, corners + 4, i) != corners + 4) continue;
+
+		const int num_tris = (int)tris.size() / 3;
+		visible.assign(num_tris, false);
+		bool outside = false;
+		for (int t = 0; t < num_tris; t++)
+		{
+			const int* tri = &tris[t * 3];
+			visible[t] = GetTriangleNormal(pts, tri).Dot(pts[i] - pts[tri[0]]) > epsilon;
+			outside = outside || visible[t];
+		}
+		if (!outside) continue;
+
+		// Edges of the visible triangles, the ones also walked the other way by a visible triangle are inside the hole
+		edges.clear();
+		for (int t = 0; t < num_tris; t++)
 		{
-			max_dist = dist; 
-			max_pt = pt;
+			if (!visible[t]) continue;
+			for (int k = 0; k < 3; k++)
+			{
+				edges.push_back(tris[t * 3 + k]);
+				edges.push_back(tris[t * 3 + (k + 1) % 3]);
+			}
+		}
+
+		int kept = 0;
+		for (int t = 0; t < num_tris; t++)
+		{
+			if (visible[t]) continue;
+			for (int k = 0; k < 3; k++) tris[kept * 3 + k] = tris[t * 3 + k];
+			kept++;
+		}
+		tris.resize(kept * 3);
+
+		for (int e = 0; e < (int)edges.size(); e += 2)
+		{
+			bool horizon = true;
+			for (int f = 0; f < (int)edges.size() && horizon; f += 2)
+			{
+				horizon = !(edges[f] == edges[e + 1] && edges[f + 1] == edges[e]);
+			}
+			if (!horizon) continue;
+
+			tris.push_back(edges[e]);
+			tris.push_back(edges[e + 1]);
+			tris.push_back(i);
 		}
 	}
 
-	Vec3 norm = dir;
-	norm.Normalize();
-	norm *= bias;
-	return max_pt + norm;
+	// Only the points the triangles use are kept
+	std::vector<int> remap(num, -1);
+	hullPoints.clear();
+	hullTriangles.resize(tris.size());
+	for (int k = 0; k < (int)tris.size(); k++)
+	{
+		if (remap[tris[k]] < 0)
+		{
+			remap[tris[k]] = (int)hullPoints.size();
+			hullPoints.push_back(pts[tris[k]]);
+		}
+		hullTriangles[k] = remap[tris[k]];
+	}
+	return true;
 }
 
-float ShapeBox::FastestLinearSpeed(const Vec3& angularVelocity, const Vec3& dir) const
+Bounds ShapeConvex::GetBounds(const Vec3& pos, const Quat& orient) const
+{
+	Bounds expanded_bounds;
+	for (const Vec3& pt : points)
+	{
+		expanded_bounds.Expand(orient.RotatePoint(pt) + pos);
+	}
+	return expanded_bounds;
+}
+
+Bounds ShapeConvex::GetBounds() const
+{
+	return bounds;
+}
+
+void ShapeConvex::Build(const std::vector<Vec3> pts, const int num)
+{
+	const std::vector<Vec3> cloud(pts.begin(), pts.begin() + num);
+	if (!BuildConvexHull(cloud, points, triangles))
+	{
+		// Flat cloud, every point is kept and the support query tries them all
+		points = cloud;
+		triangles.clear();
+	}
+
+	bounds.Clear();
+	for (const Vec3& pt : points)
+	{
+		bounds.Expand(pt);
+	}
+
+	BuildAdjacency();
+	BuildMassProperties();
+	MarkChanged();
+}
+
+void ShapeConvex::BuildAdjacency()
+{
+	const int num_points = (int)points.size();
+
+	// Every edge of a triangle joins both of its vertices, the edges shared by two triangles are kept once
+	std::vector<std::vector<int>> adjacency(num_points);
+	for (int t = 0; t + 2 < (int)triangles.size(); t += 3)
+	{
+		for (int k = 0; k < 3; k++)
+		{
+			const int a = triangles[t + k];
+			const int b = triangles[t + (k + 1) % 3];
+			adjacency[a].push_back(b);
+			adjacency[b].push_back(a);
+		}
+	}
+
+	// Without triangles every vertex is a neighbour of every other one
+	if (triangles.empty())
+	{
+		for (int i = 0; i < num_points; i++)
+		{
+			for (int j = 0; j < num_points; j++)
+			{
+				if (j != i) adjacency[i].push_back(j);
+			}
+		}
+	}
+
+	neighbourOffsets.resize(num_points + 1);
+	neighbours.clear();
+	for (int i = 0; i < num_points; i++)
+	{
+		std::vector<int>& list = adjacency[i];
+		std::sort(list.begin(), list.end());
+		list.erase(std::unique(list.begin(), list.end()), list.end());
+
+		neighbourOffsets[i] = (int)neighbours.size();
+		neighbours.insert(neighbours.end(), list.begin(), list.end());
+	}
+	neighbourOffsets[num_points] = (int)neighbours.size();
+
+	for (int k = 0; k < 6; k++)
+	{
+		Vec3 axis(0.0f);
+		axis[k / 2] = (k % 2 == 0) ? 1.0f : -1.0f;
+		extremeVertices[k] = points.empty() ? 0 : FindFurthestPoint(points, axis);
+	}
+}
+
+void ShapeConvex::BuildMassProperties()
+{
+	// The hull is cut in tetrahedra from a point inside it to each triangle, their volumes and second moments add up
+	Vec3 origin(0.0f);
+	for (const Vec3& pt : points) origin += pt;
+	origin *= 1.0f / std::max((float)points.size(), 1.0f);
+
+	float volume = 0.0f;
+	Vec3 weighted_center(0.0f);
+	float covariance[3][3] = {};
+	for (int t = 0; t + 2 < (int)triangles.size(); t += 3)
+	{
+		const Vec3 a = points[triangles[t + 0]] - origin;
+		const Vec3 b = points[triangles[t + 1]] - origin;
+		const Vec3 c = points[triangles[t + 2]] - origin;
+		const Vec3 sum = a + b + c;
+
+		// Six times the volume of the tetrahedron
+		const float det = a.Dot(b.Cross(c));
+		volume += det / 6.0f;
+		weighted_center += sum * (det / 24.0f);
+
+		for (int i = 0; i < 3; i++)
+		{
+			for (int j = 0; j < 3; j++)
+			{
+				covariance[i][j] += det / 120.0f * (a[i] * a[j] + b[i] * b[j] + c[i] * c[j] + sum[i] * sum[j]);
+			}
+		}
+	}
+
+	const Vec3 size = bounds.maxs - bounds.mins;
+	if (volume <= hullTolerance * size.x * size.y * size.z)
+	{
+		// Flat hull, it weighs like its bounding box
+		centerOfMass = (bounds.maxs + bounds.mins) * 0.5f;
+		inertiaTensor.Zero();
+		inertiaTensor.rows[0][0] = (size.y * size.y + size.z * size.z) / 12.0f;
+		inertiaTensor.rows[1][1] = (size.x * size.x + size.z * size.z) / 12.0f;
+		inertiaTensor.rows[2][2] = (size.x * size.x + size.y * size.y) / 12.0f;
+		return;
+	}
+
+	// Moved to the center of mass, then I = trace(C) * identity - C, for a unit mass
+	const Vec3 center = weighted_center * (1.0f / volume);
+	centerOfMass = origin + center;
+	for (int i = 0; i < 3; i++)
+	{
+		for (int j = 0; j < 3; j++)
+		{
+			covariance[i][j] = (covariance[i][j] - volume * center[i] * center[j]) / volume;
+		}
+	}
+
+	const float trace = covariance[0][0] + covariance[1][1] + covariance[2][2];
+	for (int i = 0; i < 3; i++)
+	{
+		for (int j = 0; j < 3; j++)
+		{
+			inertiaTensor.rows[i][j] = (i == j ? trace : 0.0f) - covariance[i][j];
+		}
+	}
+}
+
+int ShapeConvex::FindSupport(const Vec3& dir, const int start) const
+{
+	int best = start;
+	float best_dist = dir.Dot(points[best]);
+
+	// Moves to the furthest neighbour until none is further than the current vertex
+	bool improved = true;
+	while (improved)
+	{
+		improved = false;
+		const int current = best;
+		for (int n = neighbourOffsets[current]; n < neighbourOffsets[current + 1]; n++)
+		{
+			const int neighbour = neighbours[n];
+			const float dist = dir.Dot(points[neighbour]);
+			if (dist > best_dist)
+			{
+				best_dist = dist;
+				best = neighbour;
+				improved = true;
+			}
+		}
+	}
+
+	return best;
+}
+
+Vec3 ShapeConvex::SupportLocal(const Vec3& dir) const
+{
+	// The walk starts at the furthest vertex along the main axis of dir, a few edges away from the answer
+	int axis = 0;
+	if (fabsf(dir.y) > fabsf(dir[axis])) axis = 1;
+	if (fabsf(dir.z) > fabsf(dir[axis])) axis = 2;
+	const int start = extremeVertices[axis * 2 + (dir[axis] >= 0.0f ? 0 : 1)];
+
+	return points[FindSupport(dir, start)];
+}
+
+float ShapeConvex::FastestLinearSpeed(const Vec3& angularVelocity, const Vec3& dir) const
 {
 	float max_speed{ 0 };
-	for (int i = 1; i < points.size(); i++) 
+	for (int i = 0; i < (int)points.size(); i++)
 	{
-		Vec3 r = points[i] - centerOfMass; 
-		Vec3 linear_velocity = angularVelocity.Cross(r); 
-		float speed = dir.Dot(linear_velocity); 
-		if (speed > max_speed) 
+		Vec3 r = points[i] - centerOfMass;
+		Vec3 linear_velocity = angularVelocity.Cross(r);
+		float speed = dir.Dot(linear_velocity);
+		if (speed > max_speed)
 		{
 			max_speed = speed;
 		}
@@ -14,6 +14,10 @@ public:
 		SHAPE_BOX,
 		SHAPE_CONVEX
 	};
+	static const int numShapeTypes = 3;
+
+	// Shapes are deleted through this class, the vertices of boxes and hulls go with them
+	virtual ~Shape() {}
 
 	virtual ShapeType GetType() const = 0;
 	Vec3 GetCenterOfMass() const { return centerOfMass; }
@@ -23,11 +27,22 @@ public:
 	virtual Bounds GetBounds() const = 0;
 
 	virtual void Build(const std::vector<Vec3> pts, const int num) {}
-	virtual Vec3 Support(const Vec3& dir, const Vec3& pos, const Quat& orient, const float bias) = 0;
+
+	// Furthest point of the shape in body space along a body space direction, without any bias
+	virtual Vec3 SupportLocal(const Vec3& dir) const = 0;
+	// Furthest point of the shape in world space along a normalized world space direction, pushed out by bias along it
+	virtual Vec3 Support(const Vec3& dir, const Vec3& pos, const Quat& orient, const float bias) const;
+	// Fastest speed of a point of the shape along dir from the rotation alone, both vectors being in body space
 	virtual float FastestLinearSpeed(const Vec3& angularVelocity, const Vec3& dir) const { return 0.0f; }
 
+	// Increased every time the geometry changes, the bodies compare it to know their inertia tensors are stale
+	unsigned int GetRevision() const { return revision; }
+
 protected:
+	void MarkChanged() { revision++; }
+
 	Vec3 centerOfMass;
+	unsigned int revision{ 0 };
 };
 
 
@@ -45,8 +60,17 @@ public:
 	Bounds GetBounds(const Vec3& pos, const Quat& orient) const override;
 	Bounds GetBounds() const override;
 
-	Vec3 Support(const Vec3& dir, const Vec3& pos, const Quat& orient, const float bias) override;
+	Vec3 SupportLocal(const Vec3& dir) const override;
+	Vec3 Support(const Vec3& dir, const Vec3& pos, const Quat& orient, const float bias) const override;
 
+	// Resizes the sphere, the bodies using it update their inertia on the next step
+	void SetRadius(const float radiusP)
+	{
+		radius = radiusP;
+		MarkChanged();
+	}
+
+	// Read-only, see SetRadius
 	float radius;
 };
 
@@ -66,9 +90,58 @@ public:
 	Bounds GetBounds() const override;
 
 	void Build(const std::vector<Vec3> pts, const int num) override;
-	Vec3 Support(const Vec3& dir, const Vec3& pos, const Quat& orient, const float bias) override;
+	Vec3 SupportLocal(const Vec3& dir) const override;
 	float FastestLinearSpeed(const Vec3& angularVelocity, const Vec3& dir) const override;
 
 	std::vector<Vec3> points;
 	Bounds bounds;
-};
\ No newline at end of file
+};
+
+
+/// <summary>
+/// Convex hull of a cloud of points, the points inside the hull are dropped when it is built.
+/// Every vertex keeps the vertices sharing an edge with it. On a convex hull a vertex with no neighbour further
+/// along a direction is the furthest of all, so the support query walks from neighbour to neighbour and only
+/// visits a few vertices of large hulls.
+/// </summary>
+class ShapeConvex : public Shape
+{
+public:
+	ShapeConvex(const std::vector<Vec3> points_, const int num)
+	{
+		Build(points_, num);
+	}
+
+	ShapeType GetType() const override { return ShapeType::SHAPE_CONVEX; }
+	Mat3 InertiaTensor() const override { return inertiaTensor; }
+
+	Bounds GetBounds(const Vec3& pos, const Quat& orient) const override;
+	Bounds GetBounds() const override;
+
+	void Build(const std::vector<Vec3> pts, const int num) override;
+	Vec3 SupportLocal(const Vec3& dir) const override;
+	float FastestLinearSpeed(const Vec3& angularVelocity, const Vec3& dir) const override;
+
+	// Index of the furthest vertex along a body space dir, walking the edges from the vertex start
+	int FindSupport(const Vec3& dir, const int start) const;
+
+	// Vertices of the hull
+	std::vector<Vec3> points;
+	// Three indices into points per triangle, counterclockwise seen from outside
+	std::vector<int> triangles;
+	Bounds bounds;
+
+private:
+	void BuildAdjacency();
+	void BuildMassProperties();
+
+	// Neighbours of vertex i are neighbours[neighbourOffsets[i]] to neighbours[neighbourOffsets[i + 1] - 1]
+	std::vector<int> neighbourOffsets;
+	std::vector<int> neighbours;
+
+	// Furthest vertex along +x, -x, +y, -y, +z and -z, where the support query of a direction starts
+	int extremeVertices[6];
+
+	// Around the center of mass, for a unit mass
+	Mat3 inertiaTensor;
+};
@@ -0,0 +1,243 @@
+#include "SphereBatch.h"
+#include "SphereBatchKernel.h"
+#include <algorithm>
+#include <math.h>
+#include <emmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+
+
+//=====================================
+// ========== CPU DETECTION ===========
+//=====================================
+
+static void CpuId(const int leaf, const int subleaf, unsigned int registers[4])
+{
+#ifdef _MSC_VER
+	int values[4];
+	__cpuidex(values, leaf, subleaf);
+	for (int i = 0; i < 4; i++)
+	{
+		registers[i] = (unsigned int)values[i];
+	}
+#else
+	__cpuid_count(leaf, subleaf, registers[0], registers[1], registers[2], registers[3]);
+#endif
+}
+
+// Register states the OS saves on context switches
+static unsigned long long GetEnabledStates()
+{
+#ifdef _MSC_VER
+	return _xgetbv(0);
+#else
+	unsigned int low, high;
+	__asm__("xgetbv" : "=a"(low), "=d"(high) : "c"(0));
+	return ((unsigned long long)high << 32) | low;
+#endif
+}
+
+static SimdWidth DetectSimdWidth()
+{
+	unsigned int registers[4];
+	CpuId(0, 0, registers);
+	const unsigned int max_leaf = registers[0];
+
+	// AVX also needs the OS to save the 256 bit registers
+	CpuId(1, 0, registers);
+	const bool has_xsave = (registers[2] >> 27) & 1;
+	const bool has_avx = (registers[2] >> 28) & 1;
+	if (!has_xsave || !has_avx) return SimdWidth::SSE;
+
+	const unsigned long long states = GetEnabledStates();
+	const unsigned long long avx_states = 0x6;
+	if ((states & avx_states) != avx_states) return SimdWidth::SSE;
+
+	// AVX-512 adds the opmask and the upper halves of the 512 bit registers
+	if (max_leaf >= 7)
+	{
+		CpuId(7, 0, registers);
+		const bool has_avx512 = (registers[1] >> 16) & 1;
+		const unsigned long long avx512_states = 0xe6;
+		if (has_avx512 && (states & avx512_states) == avx512_states) return SimdWidth::AVX512;
+	}
+
+	return SimdWidth::AVX;
+}
+
+SimdWidth GetSupportedSimdWidth()
+{
+	static const SimdWidth width = DetectSimdWidth();
+	return width;
+}
+
+
+
+//=====================================
+// ====== SCALAR AND SSE KERNELS ======
+//=====================================
+
+struct ScalarLanes
+{
+	typedef float Float;
+	typedef bool Mask;
+	static const int width = 1;
+
+	static Float Set(const float value) { return value; }
+	static Float Load(const float* data) { return *data; }
+	static void Store(float* data, const Float value) { *data = value; }
+
+	static Float Add(const Float a, const Float b) { return a + b; }
+	static Float Sub(const Float a, const Float b) { return a - b; }
+	static Float Mul(const Float a, const Float b) { return a * b; }
+	static Float Div(const Float a, const Float b) { return a / b; }
+	static Float Sqrt(const Float a) { return sqrtf(a); }
+
+	static Mask Less(const Float a, const Float b) { return a < b; }
+	static Mask Greater(const Float a, const Float b) { return a > b; }
+	static Mask Equal(const Float a, const Float b) { return a == b; }
+
+	static Mask And(const Mask a, const Mask b) { return a && b; }
+	static Mask Or(const Mask a, const Mask b) { return a || b; }
+	static Mask Not(const Mask a) { return !a; }
+	// !a && b
+	static Mask AndNot(const Mask a, const Mask b) { return !a && b; }
+	static Float Select(const Mask mask, const Float a, const Float b) { return mask ? a : b; }
+};
+
+struct SSELanes
+{
+	typedef __m128 Float;
+	typedef __m128 Mask;
+	static const int width = 4;
+
+	static Float Set(const float value) { return _mm_set1_ps(value); }
+	static Float Load(const float* data) { return _mm_loadu_ps(data); }
+	static void Store(float* data, const Float value) { _mm_storeu_ps(data, value); }
+
+	static Float Add(const Float a, const Float b) { return _mm_add_ps(a, b); }
+	static Float Sub(const Float a, const Float b) { return _mm_sub_ps(a, b); }
+	static Float Mul(const Float a, const Float b) { return _mm_mul_ps(a, b); }
+	static Float Div(const Float a, const Float b) { return _mm_div_ps(a, b); }
+	static Float Sqrt(const Float a) { return _mm_sqrt_ps(a); }
+
+	static Mask Less(const Float a, const Float b) { return _mm_cmplt_ps(a, b); }
+	static Mask Greater(const Float a, const Float b) { return _mm_cmpgt_ps(a, b); }
+	static Mask Equal(const Float a, const Float b) { return _mm_cmpeq_ps(a, b); }
+
+	static Mask And(const Mask a, const Mask b) { return _mm_and_ps(a, b); }
+	static Mask Or(const Mask a, const Mask b) { return _mm_or_ps(a, b); }
+	static Mask Not(const Mask a) { return _mm_xor_ps(a, _mm_castsi128_ps(_mm_set1_epi32(-1))); }
+	static Mask AndNot(const Mask a, const Mask b) { return _mm_andnot_ps(a, b); }
+	static Float Select(const Mask mask, const Float a, const Float b) { return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); }
+};
+
+void SolveSpherePairsScalar(const SpherePairLanes& lanes, const int begin, const int end, const float dt)
+{
+	SolveSpherePairLanes<ScalarLanes>(lanes, begin, end, dt);
+}
+
+void SolveSpherePairsSSE(const SpherePairLanes& lanes, const int begin, const int end, const float dt)
+{
+	SolveSpherePairLanes<SSELanes>(lanes, begin, end, dt);
+}
+
+
+
+//=====================================
+// ======== SPHERE PAIR BATCH =========
+//=====================================
+
+// Pairs are padded to this count so every kernel runs full lanes
+static const int maxLanes = 16;
+
+int SpherePairBatch::Add(const Vec3& positionA, const Vec3& velocityA, const float radiusA, const Vec3& positionB, const Vec3& velocityB, const float radiusB)
+{
+	if (numPairs == stride)
+	{
+		Grow();
+	}
+
+	const int index = numPairs++;
+	for (int k = 0; k < 3; k++)
+	{
+		GetStream((Stream)(POSITION_A_X + k))[index] = positionA[k];
+		GetStream((Stream)(VELOCITY_A_X + k))[index] = velocityA[k];
+		GetStream((Stream)(POSITION_B_X + k))[index] = positionB[k];
+		GetStream((Stream)(VELOCITY_B_X + k))[index] = velocityB[k];
+	}
+	GetStream(RADIUS_A)[index] = radiusA;
+	GetStream(RADIUS_B)[index] = radiusB;
+
+	return index;
+}
+
+void SpherePairBatch::Solve(const float dt)
+{
+	if (numPairs == 0) return;
+
+	SpherePairLanes lanes;
+	for (int k = 0; k < 3; k++)
+	{
+		lanes.positionA[k] = GetStream((Stream)(POSITION_A_X + k));
+		lanes.velocityA[k] = GetStream((Stream)(VELOCITY_A_X + k));
+		lanes.positionB[k] = GetStream((Stream)(POSITION_B_X + k));
+		lanes.velocityB[k] = GetStream((Stream)(VELOCITY_B_X + k));
+		lanes.ptOnA[k] = GetStream((Stream)(PT_ON_A_X + k));
+		lanes.ptOnB[k] = GetStream((Stream)(PT_ON_B_X + k));
+	}
+	lanes.radiusA = GetStream(RADIUS_A);
+	lanes.radiusB = GetStream(RADIUS_B);
+	lanes.timeOfImpact = GetStream(TIME_OF_IMPACT);
+	lanes.hit = GetStream(HIT);
+
+	// Lanes past the last pair hold leftovers of earlier batches, their results are never read
+	const int count = (numPairs + maxLanes - 1) / maxLanes * maxLanes;
+
+	switch (std::min(width, GetSupportedSimdWidth()))
+	{
+	case SimdWidth::AVX512:
+		SolveSpherePairsAVX512(lanes, 0, count, dt);
+		break;
+	case SimdWidth::AVX:
+		SolveSpherePairsAVX(lanes, 0, count, dt);
+		break;
+	case SimdWidth::SSE:
+		SolveSpherePairsSSE(lanes, 0, count, dt);
+		break;
+	default:
+		SolveSpherePairsScalar(lanes, 0, numPairs, dt);
+		break;
+	}
+}
+
+bool SpherePairBatch::GetResult(const int index, Vec3& ptOnA, Vec3& ptOnB, float& timeOfImpact) const
+{
+	if (GetStream(HIT)[index] == 0.0f) return false;
+
+	for (int k = 0; k < 3; k++)
+	{
+		ptOnA[k] = GetStream((Stream)(PT_ON_A_X + k))[index];
+		ptOnB[k] = GetStream((Stream)(PT_ON_B_X + k))[index];
+	}
+	timeOfImpact = GetStream(TIME_OF_IMPACT)[index];
+	return true;
+}
+
+void SpherePairBatch::Grow()
+{
+	const int new_stride = std::max(maxLanes, stride * 2);
+
+	// Streams are laid out one after the other, each of them moves to its new offset
+	std::vector<float> new_streams(new_stride * NUM_STREAMS, 0.0f);
+	for (int stream = 0; stream < NUM_STREAMS; stream++)
+	{
+		std::copy(streams.begin() + stream * stride, streams.begin() + stream * stride + numPairs, new_streams.begin() + stream * new_stride);
+	}
+
+	streams.swap(new_streams);
+	stride = new_stride;
+}
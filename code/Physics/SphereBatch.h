@@ -0,0 +1,98 @@
+#pragma once
+#include <vector>
+#include "../Math/Vector.h"
+
+
+// Number of pairs solved at once by the sphere pair kernels
+enum class SimdWidth
+{
+	SCALAR = 1,
+	SSE = 4,
+	AVX = 8,
+	AVX512 = 16
+};
+
+// Widest kernel the CPU and the OS support, read once from CPUID
+SimdWidth GetSupportedSimdWidth();
+
+
+/// <summary>
+/// Streams of a batch of sphere pairs, one array per component.
+/// Every array holds a multiple of 16 pairs, so each kernel only runs full lanes.
+/// </summary>
+struct SpherePairLanes
+{
+	const float* positionA[3];
+	const float* velocityA[3];
+	const float* radiusA;
+	const float* positionB[3];
+	const float* velocityB[3];
+	const float* radiusB;
+
+	float* timeOfImpact;
+	float* ptOnA[3];
+	float* ptOnB[3];
+	// 1 where the pair collides during the step, 0 elsewhere
+	float* hit;
+};
+
+// Same test as Intersections::SphereSphereDynamic over the pairs [begin, end), begin and end being multiples of the lane count
+void SolveSpherePairsScalar(const SpherePairLanes& lanes, const int begin, const int end, const float dt);
+void SolveSpherePairsSSE(const SpherePairLanes& lanes, const int begin, const int end, const float dt);
+void SolveSpherePairsAVX(const SpherePairLanes& lanes, const int begin, const int end, const float dt);
+void SolveSpherePairsAVX512(const SpherePairLanes& lanes, const int begin, const int end, const float dt);
+
+
+/// <summary>
+/// Gathers sphere pairs into SoA streams and finds their time of impact and contact points several pairs at a time.
+/// </summary>
+class SpherePairBatch
+{
+public:
+	void Clear() { numPairs = 0; }
+
+	// Adds a pair and returns its index in the batch
+	int Add(const Vec3& positionA, const Vec3& velocityA, const float radiusA, const Vec3& positionB, const Vec3& velocityB, const float radiusB);
+
+	// Tests every pair of the batch over dt
+	void Solve(const float dt);
+
+	/// <summary>
+	/// Read the result of a pair after Solve
+	/// </summary>
+	/// <returns>
+	/// True if the pair collides during the step
+	/// </returns>
+	bool GetResult(const int index, Vec3& ptOnA, Vec3& ptOnB, float& timeOfImpact) const;
+
+	int GetNumPairs() const { return numPairs; }
+
+	// Kernel used by Solve, lowered to the supported width if the CPU lacks it
+	SimdWidth width{ GetSupportedSimdWidth() };
+
+private:
+	enum Stream
+	{
+		POSITION_A_X, POSITION_A_Y, POSITION_A_Z,
+		VELOCITY_A_X, VELOCITY_A_Y, VELOCITY_A_Z,
+		RADIUS_A,
+		POSITION_B_X, POSITION_B_Y, POSITION_B_Z,
+		VELOCITY_B_X, VELOCITY_B_Y, VELOCITY_B_Z,
+		RADIUS_B,
+		TIME_OF_IMPACT,
+		PT_ON_A_X, PT_ON_A_Y, PT_ON_A_Z,
+		PT_ON_B_X, PT_ON_B_Y, PT_ON_B_Z,
+		HIT,
+		NUM_STREAMS
+	};
+
+	float* GetStream(const Stream stream) { return &streams[stream * stride]; }
+	const float* GetStream(const Stream stream) const { return &streams[stream * stride]; }
+
+	void Grow();
+
+	// Every stream holds stride floats, a multiple of the widest lane count
+	std::vector<float> streams;
+	int stride{ 0 };
+	int numPairs{ 0 };
+};
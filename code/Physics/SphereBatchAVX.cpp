@@ -0,0 +1,38 @@
+#include "SphereBatch.h"
+#include "SphereBatchKernel.h"
+#include <immintrin.h>
+
+// Built with AVX code generation, only called once GetSupportedSimdWidth found AVX
+
+
+struct AVXLanes
+{
+	typedef __m256 Float;
+	typedef __m256 Mask;
+	static const int width = 8;
+
+	static Float Set(const float value) { return _mm256_set1_ps(value); }
+	static Float Load(const float* data) { return _mm256_loadu_ps(data); }
+	static void Store(float* data, const Float value) { _mm256_storeu_ps(data, value); }
+
+	static Float Add(const Float a, const Float b) { return _mm256_add_ps(a, b); }
+	static Float Sub(const Float a, const Float b) { return _mm256_sub_ps(a, b); }
+	static Float Mul(const Float a, const Float b) { return _mm256_mul_ps(a, b); }
+	static Float Div(const Float a, const Float b) { return _mm256_div_ps(a, b); }
+	static Float Sqrt(const Float a) { return _mm256_sqrt_ps(a); }
+
+	static Mask Less(const Float a, const Float b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+	static Mask Greater(const Float a, const Float b) { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+	static Mask Equal(const Float a, const Float b) { return _mm256_cmp_ps(a, b, _CMP_EQ_OQ); }
+
+	static Mask And(const Mask a, const Mask b) { return _mm256_and_ps(a, b); }
+	static Mask Or(const Mask a, const Mask b) { return _mm256_or_ps(a, b); }
+	static Mask Not(const Mask a) { return _mm256_xor_ps(a, _mm256_cmp_ps(a, a, _CMP_TRUE_UQ)); }
+	static Mask AndNot(const Mask a, const Mask b) { return _mm256_andnot_ps(a, b); }
+	static Float Select(const Mask mask, const Float a, const Float b) { return _mm256_blendv_ps(b, a, mask); }
+};
+
+void SolveSpherePairsAVX(const SpherePairLanes& lanes, const int begin, const int end, const float dt)
+{
+	SolveSpherePairLanes<AVXLanes>(lanes, begin, end, dt);
+}
@@ -0,0 +1,38 @@
+#include "SphereBatch.h"
+#include "SphereBatchKernel.h"
+#include <immintrin.h>
+
+// Built with AVX-512 code generation, only called once GetSupportedSimdWidth found AVX-512
+
+
+struct AVX512Lanes
+{
+	typedef __m512 Float;
+	typedef __mmask16 Mask;
+	static const int width = 16;
+
+	static Float Set(const float value) { return _mm512_set1_ps(value); }
+	static Float Load(const float* data) { return _mm512_loadu_ps(data); }
+	static void Store(float* data, const Float value) { _mm512_storeu_ps(data, value); }
+
+	static Float Add(const Float a, const Float b) { return _mm512_add_ps(a, b); }
+	static Float Sub(const Float a, const Float b) { return _mm512_sub_ps(a, b); }
+	static Float Mul(const Float a, const Float b) { return _mm512_mul_ps(a, b); }
+	static Float Div(const Float a, const Float b) { return _mm512_div_ps(a, b); }
+	static Float Sqrt(const Float a) { return _mm512_sqrt_ps(a); }
+
+	static Mask Less(const Float a, const Float b) { return _mm512_cmp_ps_mask(a, b, _CMP_LT_OQ); }
+	static Mask Greater(const Float a, const Float b) { return _mm512_cmp_ps_mask(a, b, _CMP_GT_OQ); }
+	static Mask Equal(const Float a, const Float b) { return _mm512_cmp_ps_mask(a, b, _CMP_EQ_OQ); }
+
+	static Mask And(const Mask a, const Mask b) { return (Mask)(a & b); }
+	static Mask Or(const Mask a, const Mask b) { return (Mask)(a | b); }
+	static Mask Not(const Mask a) { return (Mask)~a; }
+	static Mask AndNot(const Mask a, const Mask b) { return (Mask)(~a & b); }
+	static Float Select(const Mask mask, const Float a, const Float b) { return _mm512_mask_blend_ps(mask, b, a); }
+};
+
+void SolveSpherePairsAVX512(const SpherePairLanes& lanes, const int begin, const int end, const float dt)
+{
+	SolveSpherePairLanes<AVX512Lanes>(lanes, begin, end, dt);
+}
@@ -0,0 +1,104 @@
+#pragma once
+#include "SphereBatch.h"
+
+
+/// <summary>
+/// Sphere pair test written once for every instruction set.
+/// Lanes wraps the intrinsics of one instruction set: Float holds one float per pair, Mask one bool per pair.
+/// The operations are done in the same order as Intersections::SphereSphereDynamic and RaySphere, so every
+/// width gives the results of the scalar code. Only included by the files implementing a kernel.
+/// </summary>
+template<typename Lanes>
+void SolveSpherePairLanes(const SpherePairLanes& lanes, const int begin, const int end, const float dt)
+{
+	typedef typename Lanes::Float Float;
+	typedef typename Lanes::Mask Mask;
+
+	const Float zero = Lanes::Set(0.0f);
+	const Float one = Lanes::Set(1.0f);
+	const Float dt_lanes = Lanes::Set(dt);
+	const Float min_ray_length_sqr = Lanes::Set(0.001f * 0.001f);
+	const Float touch_tolerance = Lanes::Set(0.001f);
+
+	auto dot = [](const Float* a, const Float* b)
+	{
+		return Lanes::Add(Lanes::Add(Lanes::Mul(a[0], b[0]), Lanes::Mul(a[1], b[1])), Lanes::Mul(a[2], b[2]));
+	};
+
+	for (int i = begin; i < end; i += Lanes::width)
+	{
+		Float pos_a[3], vel_a[3], pos_b[3], vel_b[3];
+		for (int k = 0; k < 3; k++)
+		{
+			pos_a[k] = Lanes::Load(lanes.positionA[k] + i);
+			vel_a[k] = Lanes::Load(lanes.velocityA[k] + i);
+			pos_b[k] = Lanes::Load(lanes.positionB[k] + i);
+			vel_b[k] = Lanes::Load(lanes.velocityB[k] + i);
+		}
+		const Float radius_a = Lanes::Load(lanes.radiusA + i);
+		const Float radius_b = Lanes::Load(lanes.radiusB + i);
+
+		// Ray of A moving relatively to B over the step
+		Float ray_dir[3], ab[3];
+		for (int k = 0; k < 3; k++)
+		{
+			const Float relative_velocity = Lanes::Sub(vel_a[k], vel_b[k]);
+			const Float end_pt_a = Lanes::Add(pos_a[k], Lanes::Mul(relative_velocity, dt_lanes));
+			ray_dir[k] = Lanes::Sub(end_pt_a, pos_a[k]);
+			ab[k] = Lanes::Sub(pos_b[k], pos_a[k]);
+		}
+		const Float ray_length_sqr = dot(ray_dir, ray_dir);
+		const Float ab_length_sqr = dot(ab, ab);
+		const Mask short_ray = Lanes::Less(ray_length_sqr, min_ray_length_sqr);
+
+		// Ray is too short, just check if already intersecting
+		const Float short_radius = Lanes::Add(Lanes::Add(radius_a, radius_b), touch_tolerance);
+		const Mask short_hit = Lanes::Not(Lanes::Greater(ab_length_sqr, Lanes::Mul(short_radius, short_radius)));
+
+		// Ray against the sphere of both radii around B
+		const Float radius = Lanes::Add(radius_a, radius_b);
+		const Float b = dot(ab, ray_dir);
+		const Float c = Lanes::Sub(ab_length_sqr, Lanes::Mul(radius, radius));
+		const Float delta = Lanes::Sub(Lanes::Mul(b, b), Lanes::Mul(ray_length_sqr, c));
+		const Mask ray_hit = Lanes::Not(Lanes::Less(delta, zero));
+
+		const Float delta_root = Lanes::Sqrt(delta);
+		const Float inverse_a = Lanes::Div(one, ray_length_sqr);
+		Float t0 = Lanes::Select(short_ray, zero, Lanes::Mul(Lanes::Sub(b, delta_root), inverse_a));
+		Float t1 = Lanes::Select(short_ray, zero, Lanes::Mul(Lanes::Add(b, delta_root), inverse_a));
+
+		// Change from [0, 1] to [0, dt]
+		t0 = Lanes::Mul(t0, dt_lanes);
+		t1 = Lanes::Mul(t1, dt_lanes);
+
+		// Earliest positive time of impact, a collision only in the past or after the step doesn't count
+		const Float time_of_impact = Lanes::Select(Lanes::Less(t0, zero), zero, t0);
+		Mask hit = Lanes::Or(Lanes::And(short_ray, short_hit), Lanes::AndNot(short_ray, ray_hit));
+		hit = Lanes::AndNot(Lanes::Less(t1, zero), hit);
+		hit = Lanes::AndNot(Lanes::Greater(time_of_impact, dt_lanes), hit);
+
+		// Points on both spheres at the time of impact
+		Float new_pos_a[3], new_pos_b[3], normal[3];
+		for (int k = 0; k < 3; k++)
+		{
+			new_pos_a[k] = Lanes::Add(pos_a[k], Lanes::Mul(vel_a[k], time_of_impact));
+			new_pos_b[k] = Lanes::Add(pos_b[k], Lanes::Mul(vel_b[k], time_of_impact));
+			normal[k] = Lanes::Sub(new_pos_b[k], new_pos_a[k]);
+		}
+
+		// Same as Vec3::Normalize, a zero vector is left as it is
+		const Float inverse_magnitude = Lanes::Div(one, Lanes::Sqrt(dot(normal, normal)));
+		const Float check = Lanes::Mul(zero, inverse_magnitude);
+		const Mask valid = Lanes::Equal(check, check);
+
+		for (int k = 0; k < 3; k++)
+		{
+			normal[k] = Lanes::Select(valid, Lanes::Mul(normal[k], inverse_magnitude), normal[k]);
+			Lanes::Store(lanes.ptOnA[k] + i, Lanes::Add(new_pos_a[k], Lanes::Mul(normal[k], radius_a)));
+			Lanes::Store(lanes.ptOnB[k] + i, Lanes::Sub(new_pos_b[k], Lanes::Mul(normal[k], radius_b)));
+		}
+
+		Lanes::Store(lanes.timeOfImpact + i, time_of_impact);
+		Lanes::Store(lanes.hit + i, Lanes::Select(hit, one, zero));
+	}
+}
@@ -0,0 +1,103 @@
+#include "ThreadPool.h"
+
+
+ThreadPool::ThreadPool(const int numThreads)
+{
+	int count = numThreads;
+	if (count <= 0)
+	{
+		count = (int)std::thread::hardware_concurrency();
+	}
+
+	for (int i = 1; i < count; i++)
+	{
+		workers.emplace_back(&ThreadPool::WorkerLoop, this);
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		quit = true;
+	}
+	wakeCondition.notify_all();
+
+	for (std::thread& worker : workers)
+	{
+		worker.join();
+	}
+}
+
+void ThreadPool::Run(const int numTasks, TaskFunction function, const void* context)
+{
+	if (numTasks <= 0) return;
+
+	// Not worth waking the workers up
+	if (workers.empty() || numTasks == 1)
+	{
+		for (int i = 0; i < numTasks; i++)
+		{
+			function(context, i);
+		}
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		currentFunction = function;
+		currentContext = context;
+		taskCount = numTasks;
+		nextTask = 0;
+		pendingWorkers = (int)workers.size();
+		generation++;
+	}
+	wakeCondition.notify_all();
+
+	RunTasks();
+
+	std::unique_lock<std::mutex> lock(mutex);
+	doneCondition.wait(lock, [this] { return pendingWorkers == 0; });
+	currentFunction = nullptr;
+	currentContext = nullptr;
+}
+
+void ThreadPool::GetTaskRange(const int task, const int numTasks, const int count, int& begin, int& end)
+{
+	begin = (int)((long long)count * task / numTasks);
+	end = (int)((long long)count * (task + 1) / numTasks);
+}
+
+void ThreadPool::WorkerLoop()
+{
+	unsigned int last_generation = 0;
+
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			wakeCondition.wait(lock, [&] { return quit || generation != last_generation; });
+			if (quit) return;
+			last_generation = generation;
+		}
+
+		RunTasks();
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			pendingWorkers--;
+			if (pendingWorkers == 0)
+			{
+				doneCondition.notify_one();
+			}
+		}
+	}
+}
+
+void ThreadPool::RunTasks()
+{
+	for (int i = nextTask++; i < taskCount; i = nextTask++)
+	{
+		currentFunction(currentContext, i);
+	}
+}
@@ -0,0 +1,66 @@
+#pragma once
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+
+/// <summary>
+/// Fixed set of worker threads sleeping until a parallel loop is submitted.
+/// The calling thread takes part in the loop, so a pool of one thread runs everything inline.
+/// </summary>
+class ThreadPool
+{
+public:
+	// 0 uses one thread per hardware core
+	ThreadPool(const int numThreads = 0);
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	// Number of threads running a loop, the calling thread included
+	int GetNumThreads() const { return (int)workers.size() + 1; }
+
+	/// <summary>
+	/// Run task(i) for every i in [0, numTasks) and return once they are all done.
+	/// Tasks are picked in any order by any thread, so each one must write to its own output.
+	/// The task is only referenced, never copied, so submitting a loop doesn't allocate.
+	/// </summary>
+	template<typename Task>
+	void ParallelFor(const int numTasks, const Task& task)
+	{
+		Run(numTasks, &CallTask<Task>, &task);
+	}
+
+	// Splits [0, count) in numTasks contiguous ranges and returns the one of the task
+	static void GetTaskRange(const int task, const int numTasks, const int count, int& begin, int& end);
+
+private:
+	typedef void (*TaskFunction)(const void* context, const int task);
+
+	template<typename Task>
+	static void CallTask(const void* context, const int task)
+	{
+		(*static_cast<const Task*>(context))(task);
+	}
+
+	void Run(const int numTasks, TaskFunction function, const void* context);
+	void WorkerLoop();
+	void RunTasks();
+
+	std::vector<std::thread> workers;
+
+	std::mutex mutex;
+	std::condition_variable wakeCondition;
+	std::condition_variable doneCondition;
+
+	TaskFunction currentFunction{ nullptr };
+	const void* currentContext{ nullptr };
+	int taskCount{ 0 };
+	std::atomic<int> nextTask{ 0 };
+	int pendingWorkers{ 0 };
+	unsigned int generation{ 0 };
+	bool quit{ false };
+};
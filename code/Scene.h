@@ -3,10 +3,14 @@
 //
 #pragma once
 #include <vector>
-#include <memory>
 
 
-#include "Physics/Body.h"
+#include "Physics/BodyStore.h"
+#include "Physics/BroadphaseSystem.h"
+#include "Physics/PairCache.h"
+#include "Physics/NarrowPhase.h"
+#include "Physics/Islands.h"
+#include "Math/FrameArena.h"
 #include "Petanque/Boule.h"
 #include "Petanque/Cochonnet.h"
 
@@ -17,7 +21,7 @@ Scene
 */
 class Scene {
 public:
-	Scene() { bodies.reserve( 128 ); }
+	Scene() { bodies.Reserve( 128 ); }
 	~Scene();
 
 	void Reset();
@@ -27,11 +31,20 @@ public:
 	//void LaunchCochonnet();
 	//void LaunchBoule();
 
-	std::vector<std::shared_ptr<Body>> bodies;
+	BodyStore bodies;
+
+	ThreadPool threadPool;
+	BroadPhase broadPhase{ threadPool };
+	PairCache pairCache;
+	NarrowPhase narrowPhase{ threadPool };
+	Islands islands{ threadPool };
+
+	// Scratch memory of the solvers, everything allocated in it is released at the start of the next update
+	FrameArena frameArena;
 
 	//bool cochonnetLaunched{ false };
-	//std::shared_ptr<Cochonnet> cochonnet;
-	//std::vector<std::shared_ptr<Boule>> boules;
+	//BodyHandle cochonnet;
+	//std::vector<BodyHandle> boules;
 
 	bool bodiesUpdated{ false };
 
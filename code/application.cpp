@@ -80,7 +80,7 @@ void Application::Initialize() {
 	m_models.reserve( scene->bodies.size() );
 	for ( int i = 0; i < scene->bodies.size(); i++ ) {
 		Model * model = new Model();
-		model->BuildFromShape( scene->bodies[ i ]->shape );
+		model->BuildFromShape( scene->bodies.shapes[ i ] );
 		model->MakeVBO( &deviceContext );
 
 		m_models.push_back( model );
@@ -495,7 +495,7 @@ void Application::MainLoop() {
 			for (int i = 0; i < scene->bodies.size(); i++) 
 			{
 				Model* model = new Model(); 
-				model->BuildFromShape(scene->bodies[i]->shape); 
+				model->BuildFromShape(scene->bodies.shapes[i]); 
 				model->MakeVBO(&deviceContext); 
 
 				m_models.push_back(model); 
@@ -542,9 +542,8 @@ void Application::MainLoop() {
 
 		if ( runPhysics ) {
 			int startTime = GetTimeMicroseconds();
-			for ( int i = 0; i < 2; i++ ) {
-				scene->Update( dt_sec * 0.5f );
-			}
+			// One step per frame: contacts are tested again after each impact, so the capped step doesn't tunnel
+			scene->Update( dt_sec );
 			int endTime = GetTimeMicroseconds();
 
 			dt_us = (float)endTime - (float)startTime;
@@ -670,13 +669,13 @@ void Application::UpdateUniforms() {
 		//	Update the uniform buffer with the body positions/orientations
 		//
 		for ( int i = 0; i < scene->bodies.size(); i++ ) {
-			std::shared_ptr<Body> body = scene->bodies[ i ];
+			const Body body = scene->bodies[ i ];
 
-			Vec3 fwd = body->orientation.RotatePoint( Vec3( 1, 0, 0 ) );
-			Vec3 up = body->orientation.RotatePoint( Vec3( 0, 0, 1 ) );
+			Vec3 fwd = body.orientation.RotatePoint( Vec3( 1, 0, 0 ) );
+			Vec3 up = body.orientation.RotatePoint( Vec3( 0, 0, 1 ) );
 
 			Mat4 matOrient;
-			matOrient.Orient( body->position, fwd, up );
+			matOrient.Orient( body.position, fwd, up );
 			matOrient = matOrient.Transpose();
 
 			// Update the uniform buffer with the orientation of this body
@@ -686,8 +685,8 @@ void Application::UpdateUniforms() {
 			renderModel.model = m_models[ i ];
 			renderModel.uboByteOffset = uboByteOffset;
 			renderModel.uboByteSize = sizeof( matOrient );
-			renderModel.pos = body->position;
-			renderModel.orient = body->orientation;
+			renderModel.pos = body.position;
+			renderModel.orient = body.orientation;
 			m_renderModels.push_back( renderModel );
 
 			uboByteOffset += deviceContext.GetAligendUniformByteOffset( sizeof( matOrient ) );